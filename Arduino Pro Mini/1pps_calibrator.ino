@@ -6,12 +6,18 @@
 //
 //v0.1: 4/24/2018 - initial release
 //v0.2: 4/25/2018 - fixed a minor bug in initialization
+//v0.3: 10/18/2026 - calibration saved to eeprom and used to seed the average on the next reset
+//v0.4: 10/18/2026 - non-blocking start: the isr acquires the first 1pps pulse, a watchdog reports when it's missing
+//v0.5: 10/18/2026 - captures passed to loop() through a ring, with an overflow count, instead of a single variable
+//v0.6: 10/18/2026 - isr status read by loop() through a sequence counter, without masking interrupts
+//v0.7: 10/18/2026 - isr latency / duration measured
+//v0.8: 10/18/2026 - optional external clock: timer1 counts an external oscillator on T1, to measure it
 //
 //Connections:
 //
 //                              |---------------------|
 //      1PPS generator -------->|ICP1/PB0/D8          |
-//                              |                     |
+//ext. osc. (optional) -------->|T1/PD5/D5            |
 //                              |                     |
 //                              |                     |
 //                              |                     |
@@ -32,32 +38,144 @@
 //
 //
 
+#include <EEPROM.h>				//we use eeprom
+
 //global defines
+//#define EXTCLK_USED				//timer1 counts an external oscillator on T1/PD5/D5, instead of the cpu clock. uncomment to use
+#define F_EXT			6000000ul	//nominal frequency of the external oscillator: within +/-32767Hz of the actual one, below F_CPU / 2.5
+#if defined(EXTCLK_USED)
+#define F_CLK			(F_EXT)		//clock of the oscillator to be measured
+#define T1_CS			0x07		//timer1 clock: T1 pin, rising edge
+#else
 #define F_CLK			(F_CPU)		//estimated clock speed
+#define T1_CS			0x01		//timer1 clock: cpu, 1:1 prescaler
+#endif
 #define F_IN 			1 			//frequency of input pulse train 
 #define F_OVERSAMPLE	4			//number of oversamples
+#define PPS_TIMEOUT		2			//seconds without a 1pps pulse before it's reported missing and re-acquired
+#define FREQC_WAIT		0			//acquisition state: waiting for the first 1pps pulse
+#define FREQC_RUN		1			//acquisition state: running
+#define CAP_N			8			//capture ring size, a power of 2
+#define CAP_FIRST		(1<<0)		//capture flag: first reading after (re)acquisition
+#define CAP_OVF			(1<<1)		//capture flag: records were dropped just before this one
+//#define ISR_STATS				//worst-case isr latency / duration measured and reported. uncomment to use
+#define NV_USED						//calibration saved to eeprom, to seed the average on the next reset. comment out to disable
+#define NV_ADDR			0			//address of the record in eeprom
+#define NV_KEY			0xa55a		//checksum key: blank eeprom (all 0x00 / 0xff) doesn't pass
+#define NV_FIRST		600			//first save, readings after reset - the average has settled by then
+#define NV_EVERY		3600		//then one save every NV_EVERY readings - eeprom endurance is ~100k cycles
+
+//calibration record, kept in eeprom
+typedef struct {
+	int32_t freq;					//learned frequency, integer part, ticks per reading
+	uint8_t frac;					//learned frequency, fractional part, 1/256 tick
+	uint16_t chk;					//checksum over the fields above, filled in by nv_write()
+} nv_t;
+
+//capture record, from the isr to loop()
+typedef struct {
+	uint16_t tick;					//capture
+	int32_t ticks;					//ticks since the previous record
+	uint8_t flags;					//CAP_xxx
+} cap_t;
+//isr status, for loop(): written by the isr under cap_seq, copied out by snap_read()
+typedef struct {
+	int32_t ticks;					//latest interval
+	uint16_t gates;					//gates captured
+	uint16_t ovf;					//records dropped, cap_ovf
+	uint16_t lat;					//worst-case isr latency, edge to entry, cycles
+	uint16_t dur;					//worst-case isr duration, entry to exit, cycles
+} snap_t;
+#if defined(ISR_STATS)
+#define ISR_ENTER()	uint16_t isr_t0 = TCNT1	//timer1 on entry, after the compiler's context save: 1:1 prescaler -> cycles
+#define ISR_EXIT()	do {cap_seq += 1; if ((uint16_t) (isr_t0 - tick1) > cap_snap.lat) cap_snap.lat = isr_t0 - tick1; if ((uint16_t) (TCNT1 - isr_t0) > cap_snap.dur) cap_snap.dur = TCNT1 - isr_t0; cap_seq += 1;} while (0)
+#else
+#define ISR_ENTER()
+#define ISR_EXIT()
+#endif
 
 //global variable
 volatile uint16_t tick0, tick1;		//tick0=previous tick / capture, tick1 = current tick / capture
 volatile uint32_t freq=F_CLK;		//current capture
 volatile  int32_t freq_error;		//frequency error 
-volatile uint8_t  freq_available=0;	//frequency available indicator: 1->new data available, 0->no new data available
+volatile cap_t    cap_buf[CAP_N];	//capture ring, single producer (isr) / single consumer (loop())
+volatile uint8_t  cap_head=0;		//next slot to be written, by the isr only
+volatile uint8_t  cap_tail=0;		//next slot to be read, by loop() only
+volatile uint16_t cap_ovf=0;		//records dropped because the ring was full, written by the isr only
+volatile uint8_t  cap_flags=0;		//flags for the next record, isr only
+volatile snap_t   cap_snap;			//isr status, multi-byte: read it through snap_read() only
+volatile uint8_t  cap_seq=0;		//cap_snap sequence counter: odd while the isr is updating it
           int32_t freq_sum;			//moving sumes
           int32_t freq_i, freq_f;	//interger + fractional parts of freq
 char uRAM[80];						//uart buffer
+volatile uint8_t  freqc_state = FREQC_WAIT;	//acquisition state
+volatile uint8_t  pps_seen = 0;		//1->a 1pps pulse has arrived, cleared by the watchdog in loop()
+uint32_t pps_time;					//time of the last 1pps pulse, millis()
+#if defined(NV_USED)
+nv_t nv;							//calibration record
+uint16_t nv_cnt;					//readings to the next save, downcounter
+#endif
 
 //timer1 icp ISR
 ISR(TIMER1_CAPT_vect) {
+	ISR_ENTER();					//for isr statistics
 	//clear the flag - done automatically
 	//read capture values first to avoid overrun
 	//tick1 = ICR1L;				//read ICPL first
 	//tick1|= ICR1H << 8;			//read ICPH second
 	tick1 = ICR1;
+	pps_seen = 1;					//for the watchdog
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start on it
+		tick0 = tick1;
+		freqc_state = FREQC_RUN;
+		cap_flags |= CAP_FIRST;
+		ISR_EXIT();
+		return;
+	}
 	//freq = (F_CLK & 0xffff0000ul) + (int16_t) (tick1 - tick0);	//calculate the frequency
-	freq_error = (int16_t) (tick1 - (tick0 + F_CLK)); freq = F_CLK + freq_error;	//calculate the frequency / frequency error
+	freq_error = (int16_t) (tick1 - (tick0 + F_CLK));	//calculate the frequency error
+	if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the record
+		cap_buf[cap_head % CAP_N].tick  = tick1;
+		cap_buf[cap_head % CAP_N].ticks = F_CLK + freq_error;
+		cap_buf[cap_head % CAP_N].flags = cap_flags;
+		cap_flags = 0;
+		cap_head += 1;				//publish the record, after it has been written
+	} else {						//ring full: drop the record
+		cap_ovf += 1;
+		cap_flags |= CAP_OVF;
+	}
+	cap_seq += 1;					//odd: cap_snap is being updated
+	cap_snap.ticks = F_CLK + freq_error;
+	cap_snap.gates += 1;
+	cap_snap.ovf = cap_ovf;
+	cap_seq += 1;					//even: cap_snap is consistent
 	tick0 = tick1;					//update captured tick
-	freq_available = 1;				//1->new data available
+	ISR_EXIT();
+}
+
+#if defined(NV_USED)
+//checksum: fletcher-16, keyed
+uint16_t nv_chk(const uint8_t *p, uint8_t n) {
+	uint16_t s1 = 0, s2 = 0;
+
+	while (n--) {s1 = (s1 + *p++) % 255; s2 = (s2 + s1) % 255;}
+	return ((s2 << 8) | s1) ^ NV_KEY;
+}
+
+//read the calibration record
+//return 0 if valid, -1 if blank / corrupted
+int8_t nv_read(nv_t *nv) {
+	EEPROM.get(NV_ADDR, *nv);
+	return (nv->chk == nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk))) ? 0 : -1;
+}
+
+//write the calibration record
+//EEPROM.put() only writes the bytes that changed
+void nv_write(nv_t *nv) {
+	nv->chk = nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk));
+	EEPROM.put(NV_ADDR, *nv);
 }
+#endif
 
 //initialize tmr1
 //ICP1/PB0/D8 enabled, 
@@ -75,18 +193,46 @@ void tmr1_init(void) {
 	TIMSK1&=~(1<<ICIE1);			//0->disable the interrupt, 1->enable the interrupt
 
 	//enable the clock 
-	TCCR1B = (TCCR1B &~0x07) | (0x01 & 0x07);	//0->stop the timer1, 0x01->1:1 prescaler 
+#if defined(EXTCLK_USED)
+	DDRD &=~(1<<5);					//T1/PD5 as input
+#endif
+	TCCR1B = (TCCR1B &~0x07) | (T1_CS & 0x07);	//0->stop the timer1, 0x01->1:1 prescaler, 0x07->T1 pin, rising edge
 	//timer1 is now running
 
 }
 
+//consistent copy of the isr status, without masking interrupts
+//the copy is retried if the isr updated cap_snap in the middle of it
+void snap_read(snap_t *snap) {
+	uint8_t seq;
+
+	do {
+		seq = cap_seq;
+		snap->ticks = cap_snap.ticks;
+		snap->gates = cap_snap.gates;
+		snap->ovf   = cap_snap.ovf;
+		snap->lat   = cap_snap.lat;
+		snap->dur   = cap_snap.dur;
+	} while ((seq & 1) || seq != cap_seq);
+}
+
 //initialize frequency calibrator 
 void freqc_init(void) {
 	//initialize the variables
-	freq_available = 0;				//0->no new data available
+	cap_head = cap_tail = 0;		//empty capture ring
+	cap_flags = 0; cap_ovf = 0;
+	cap_seq = 0; cap_snap.ticks = 0; cap_snap.gates = cap_snap.ovf = 0;
+	cap_snap.lat = cap_snap.dur = 0;
 	freq = F_CLK;					//freq initial value estimate
 	freq_sum = freq * F_OVERSAMPLE;	//over sample
 	freq_i = freq_sum / F_OVERSAMPLE;
+#if defined(NV_USED)
+	nv_cnt = NV_FIRST;				//reset the save counter
+	if (nv_read(&nv) == 0) {		//valid calibration from the last run: start from it
+		freq_sum = nv.freq * F_OVERSAMPLE + (((uint16_t) nv.frac * F_OVERSAMPLE) >> 8);
+		freq_i = freq_sum / F_OVERSAMPLE;
+	}
+#endif
 
 	//initialize the pin
 	pinMode(8, INPUT_PULLUP);		//ICP1/D8/PB0 as input
@@ -94,14 +240,9 @@ void freqc_init(void) {
 
 	tmr1_init();					//initialize tmr1 icp, interrupt disabled
 
-	//wait for the first capture event
-	while ((TIFR1 & (1<<ICF1)) == 0) continue;
-	TIFR1 |= (1<<ICF1);				//1->clear the flag
-	//read capture values first to avoid overrun
-	//tick0 = ICR1L;				//read ICPL first
-	//tick0|= (ICR1H << 8);			//read ICPH second
-	tick0 = ICR1;
-	TIMSK1|= (1<<ICIE1);			//enable capture interrupt for future events
+	//don't wait for the first capture: the isr starts on it
+	freqc_state = FREQC_WAIT;		//waiting for the first 1pps pulse
+	TIMSK1|= (1<<ICIE1);			//enable capture interrupt
 }
 
 void setup() {
@@ -117,26 +258,63 @@ void setup() {
 }
 
 void loop() {
+	static uint16_t ovf = 0;		//cap_ovf last reported
+#if defined(ISR_STATS)
+	static uint16_t lat = 0, dur = 0;	//isr latency / duration last reported
+#endif
+	cap_t cap;						//current capture record
+	snap_t snap;
+
 	// put your main code here, to run repeatedly:
 		//debug only
-		//Serial.print("freq_available="); Serial.print(freq_available); Serial.print(".\n\r");
+		//Serial.print("cap_head="); Serial.print(cap_head); Serial.print(".\n\r");
 
 #if 1
-	if (freq_available) {			//new data is available
-		freq_available = 0;			//no new data is available
+	while (cap_tail != cap_head) {	//new data is available: process every record in the ring
+		cap = cap_buf[cap_tail % CAP_N];	//copy the record out, then free its slot
+		cap_tail += 1;
+		freq = cap.ticks;			//frequency measurement
 		
 		//update moving average
 		freq_sum += (freq - freq_i);	//update the sum
 		freq_i = freq_sum / F_OVERSAMPLE;
 		freq_f = freq_sum - freq_i * F_OVERSAMPLE;
+#if defined(NV_USED)
+		//save the calibration - rarely, for eeprom endurance
+		if (--nv_cnt == 0) {
+			nv_cnt = NV_EVERY;
+			nv.freq = freq_i;
+			nv.frac = (freq_f << 8) / F_OVERSAMPLE;
+			nv_write(&nv);
+		}
+#endif
 
 		//send the string
-		Serial.print("freq = "); Serial.print(freq); Serial.print("Hz.\n\r");
+		//the reading, then the average: seeded from the eeprom with NV_USED, it is right from the first line
+		sprintf(uRAM, "freq = %8luHz, freq = %8ld.%03dHz.\n\r", freq, freq_i, (int) ((freq_f * 1000 + F_OVERSAMPLE / 2) / F_OVERSAMPLE)); Serial.print(uRAM);
 		//Serial.print("freq = "); Serial.print(freq_i); Serial.print("."); Serial.print((freq_f * 1000 + F_OVERSAMPLE / 2) / F_OVERSAMPLE); Serial.print("Hz, error = "); Serial.print(freq_i - F_CLK); Serial.print("Hz.\n\r");
 		//sprintf(uRAM, "freq = %8ld.%03dHz", freq_i, (freq_f * 1000 + F_OVERSAMPLE / 2) / F_OVERSAMPLE); Serial.print(uRAM); Serial.print(", error = "); Serial.print(freq_i - F_CLK); Serial.print("Hz.\n\r");
 		//blink the led
 		digitalWrite(13, !digitalRead(13));	//flip pin 13
 	}
+	snap_read(&snap);
+	if (snap.ovf != ovf) {			//records were dropped: report it
+		ovf = snap.ovf;
+		Serial.print("overflow = "); Serial.print(ovf); Serial.print(" records of "); Serial.print(snap.gates); Serial.print(" gates.\n\r");
+	}
+#if defined(ISR_STATS)
+	if (snap.lat != lat || snap.dur != dur) {	//new worst case: report it
+		lat = snap.lat; dur = snap.dur;
+		Serial.print("isr: latency <= "); Serial.print(lat); Serial.print(", duration <= "); Serial.print(dur); Serial.print(" cycles.\n\r");
+	}
+#endif
+	//1pps watchdog: report when it's missing, re-acquire when it comes back
+	if (pps_seen) {pps_seen = 0; pps_time = millis();}
+	else if (millis() - pps_time > PPS_TIMEOUT * 1000ul) {
+		pps_time = millis();			//report once every PPS_TIMEOUT
+		freqc_state = FREQC_WAIT;		//the next pulse restarts the measurement
+		Serial.print("waiting for PPS...\n\r");
+	}
 #endif
 		
 		//delay(100);
@@ -0,0 +1,131 @@
+//adev.c
+//Frequency stability of the readings in a columnar file: ADEV, MDEV, HDEV and TOTDEV
+//
+//The readings are taken as consecutive, tau0 apart, and turned into fractional frequency
+//against the nominal (default: their mean), then into phase. Every (statistic, tau) pair is
+//one O(n) pass over the phase; the passes are shared out to all cores (see stab.h).
+//Output is csv: statistic, tau, m, terms, edf, deviation and its 1-sigma confidence interval.
+//Timing is reported on stderr.
+//
+//Usage:
+//  adev [-j threads] [-f nominal_hz] [-t tau0_s] [-d] [-k amht] col_file
+//
+//  -j number of threads, default: one per online cpu
+//  -f nominal frequency, default: the mean of the readings
+//  -t sampling interval, default: from the timestamps, 1s if there are none
+//  -d taus 1, 2, 5, 10, ... x tau0, default 1, 2, 4, 8, ... x tau0
+//  -k statistics: a(dev), m(dev), h(dev), t(otdev), default all
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use int64_t
+#include <string.h>						//we use strchr
+#include <math.h>						//we use sqrt
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include <pthread.h>					//we use pthreads
+#include "colstore.h"					//we use columnar store
+#include "stab.h"						//we use stability statistics
+
+//global defines
+#define THREAD_MAX	256					//max. number of threads
+#define TAU_MAX		256					//max. taus per statistic
+
+//one (statistic, tau) pair
+typedef struct {
+	int kind;
+	size_t m;
+	size_t terms;						//0 -> not computed
+	double var;
+} task_t;
+
+//global variables
+static double *x;						//phase, s
+static size_t nx;
+static double tau0 = 0;
+static task_t *task;
+static size_t ntask;
+static size_t next_task = 0;			//next pair to be computed, shared by the threads
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//worker: compute pairs until none is left
+static void *worker(void *arg) {
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED)) < ntask)
+		task[i].terms = stab_var(task[i].kind, x, nx, task[i].m, tau0, &task[i].var);
+	return NULL;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: adev [-j threads] [-f nominal_hz] [-t tau0_s] [-d] [-k amht] col_file\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	long nthread = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t tid[THREAD_MAX];
+	const char *kinds = "amht";
+	double f0 = 0, dev, lo, hi;
+	size_t i, m, step;
+	int opt, k, decade = 0;
+	int64_t t0, t1, t2;
+	cs_t cs;
+
+	while ((opt = getopt(argc, argv, "j:f:t:dk:h")) != -1) {
+		switch (opt) {
+			case 'j': nthread = strtol(optarg, NULL, 0); break;
+			case 'f': f0 = atof(optarg) * 1000; break;
+			case 't': tau0 = atof(optarg); break;
+			case 'd': decade = 1; break;
+			case 'k': kinds = optarg; break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 1 || nthread < 1) usage();
+	if (nthread > THREAD_MAX) nthread = THREAD_MAX;
+
+	//readings -> fractional frequency -> phase
+	t0 = now_ns();
+	if (cs_read(argv[optind], &cs)) {perror(argv[optind]); return 1;}
+	if (cs.n < 3) {fprintf(stderr, "adev: too few readings\n"); return 1;}
+	nx = cs.n + 1;
+	if ((x = stab_load(&cs, 1, &tau0, &f0)) == NULL) {fprintf(stderr, "adev: out of memory\n"); return 1;}
+	cs_free(&cs);
+
+	//the pairs: every one is a pass over the whole phase, so they cost about the same
+	task = malloc(STAB_KINDS * TAU_MAX * sizeof(task_t));
+	for (k = 0; k < STAB_KINDS; k++) {
+		if (strchr(kinds, stab_name[k][0]) == NULL) continue;
+		for (m = 1, step = 0; m <= stab_mmax(k, nx) && ntask < STAB_KINDS * TAU_MAX; step++) {
+			task[ntask].kind = k; task[ntask].m = m; task[ntask].terms = 0;
+			ntask += 1;
+			m = decade ? (size_t) ((step % 3 == 1) ? m / 2 * 5 : m * 2) : m * 2;	//1, 2, 5, 10, 20, 50, ...
+		}
+	}
+	t1 = now_ns();
+	for (i = 0; i < (size_t) nthread; i++) pthread_create(&tid[i], NULL, worker, NULL);
+	for (i = 0; i < (size_t) nthread; i++) pthread_join(tid[i], NULL);
+	t2 = now_ns();
+
+	printf("dev,tau_s,m,terms,edf,sigma,sigma_lo,sigma_hi\n");
+	for (i = 0; i < ntask; i++) {
+		if (task[i].terms == 0) continue;
+		dev = sqrt(task[i].var);
+		stab_ci(dev, stab_edf(task[i].kind, nx, task[i].m), &lo, &hi);
+		printf("%s,%g,%zu,%zu,%.1f,%.4e,%.4e,%.4e\n", stab_name[task[i].kind], task[i].m * tau0, task[i].m, task[i].terms,
+			stab_edf(task[i].kind, nx, task[i].m), dev, lo, hi);
+	}
+	fprintf(stderr, "adev: %zu readings, tau0 %gs, f0 %.3fHz, %zu points, %ld thread(s): load %.3fs, compute %.3fs\n",
+		nx - 1, tau0, f0 / 1000, ntask, nthread, (t1 - t0) * 1e-9, (t2 - t1) * 1e-9);
+	free(x); free(task);
+	return 0;
+}
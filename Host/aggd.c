@@ -0,0 +1,408 @@
+//aggd.c
+//Aggregator of the serial output of many calibrators into one stream
+//
+//Single-threaded: all devices are non-blocking and served from one epoll loop, so
+//hundreds of them cost one thread and no cpu while they are idle. Each line is stamped
+//with the time of arrival of its first byte (CLOCK_REALTIME) and written out as
+//  [seconds.nanoseconds] device line
+//the devices are interleaved: ingest -d device takes one of them out, replay -a all of them,
+//each to its own pty. Devices that go away (usb adapter unplugged) are reopened once a second.
+//
+//Each device may send the ascii lines of the current firmware, or binary frames:
+//  0xa5 0x5a type len payload[len] chk(u16)
+//  type 1: reading, payload = freq (u32, Hz) frac (u16, 1/1000 Hz), little-endian
+//  chk = fletcher-16 over type, len and payload
+//binary readings are written out as "freq = N.fffHz." lines, so the merged stream is uniform.
+//
+//With -m, the readings are also published, decoded, in a shared-memory ring (see shmring.h),
+//stamped with their utc tag where the calibrator has one (see freqlog.h), else their time of arrival:
+//local consumers (plots, alarms, loggers) map it and read at their own pace, without a
+//pipe, a socket or a copy through the kernel - and without slowing aggd down.
+//
+//With -s / -t, the stream is also served to subscribers over a unix-domain socket / a tcp
+//port on the loopback interface. A subscriber gets the readings of all devices, decoded:
+//  [seconds.nanoseconds] device freq = N.fffHz.
+//and may narrow or widen that by sending lines of
+//  sub device|* freq|all|none
+//  freq: the readings only; all: every line, readings decoded and the others (temp,
+//  overflow, ...) as they are; none: nothing. applied in order, e.g. "sub * none" then
+//  "sub ttyUSB3 all".
+//Each subscriber has a fixed output buffer (SUB_BUF): whatever doesn't fit when it reads
+//too slowly is dropped, and it is told so with a "# dropped N" line once it catches up.
+//A slow subscriber thus costs neither memory nor time to aggd and the others.
+//
+//Usage:
+//  aggd [-b baud] [-o out_file] [-m shm_name] [-n slots] [-s socket_path] [-t tcp_port] device...
+//
+//  -b baud rate, default 9600
+//  -o output file, default stdout. appended to
+//  -m shared-memory ring to publish the readings in, e.g. pps -> /dev/shm/pps
+//  -n slots in the ring, default 4096
+//  -s unix-domain socket to serve subscribers on, e.g. /tmp/aggd.sock
+//  -t tcp port to serve subscribers on, 127.0.0.1 only
+//
+//v0.1: 10/18/2026 - initial release
+//v0.2: 10/18/2026 - readings published in a shared-memory ring
+//v0.3: 10/18/2026 - readings streamed to subscribers over a local socket
+//
+
+#define _GNU_SOURCE						//we use cfmakeraw
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use uint32_t
+#include <string.h>						//we use strrchr
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include <fcntl.h>						//we use open
+#include <errno.h>						//we use errno
+#include <signal.h>						//we use signal
+#include <termios.h>					//we use termios
+#include <sys/epoll.h>					//we use epoll
+#include <sys/socket.h>					//we use socket
+#include <sys/un.h>						//we use sockaddr_un
+#include <netinet/in.h>					//we use sockaddr_in
+#include "freqlog.h"					//we use log parser
+#include "shmring.h"					//we use shared-memory ring
+
+//global defines
+#define LINE_MAX	256					//max. line length, longer lines are cut
+#define EV_MAX		64					//events per epoll_wait()
+#define REOPEN_MS	1000				//retry period for devices that went away
+#define FR_SYNC0	0xa5				//binary frame: sync bytes
+#define FR_SYNC1	0x5a
+#define FR_READING	1					//binary frame: reading
+#define SUB_BUF		(256 * 1024)		//output buffer per subscriber, bytes
+#define SUB_MAX		256					//max. number of subscribers
+#define SUB_FREQ	1					//subscription: readings
+#define SUB_OTHER	2					//subscription: other lines
+
+//kinds of objects in the epoll set: the first member of each
+enum {EP_DEV, EP_LISTEN, EP_SUB};
+
+//per device state
+typedef struct {
+	int type;							//EP_DEV
+	const char *path;					//device
+	const char *name;					//its name in the output
+	int fd;								//-1 -> closed, to be reopened
+	char line[LINE_MAX];				//line being received
+	size_t n;							//its length
+	struct timespec ts;					//arrival of its first byte
+	uint8_t fr[6 + 255];				//binary frame being received: header, payload, checksum
+	size_t fn;							//its length, 0 -> not in a frame
+} chan_t;
+
+//listening socket
+typedef struct {
+	int type;							//EP_LISTEN
+	int fd;
+} lsn_t;
+
+//per subscriber state
+typedef struct {
+	int type;							//EP_SUB
+	int fd;								//-1 -> slot free
+	uint8_t *want;						//per device: SUB_FREQ | SUB_OTHER
+	char in[128];						//command line being received
+	size_t in_n;
+	char *buf;							//output not yet sent
+	size_t n;
+	uint64_t drop;						//lines dropped since the last notice
+	int pollout;						//1 -> waiting for EPOLLOUT
+} sub_t;
+
+//global variables
+static chan_t *dev;						//devices
+static int ndev;
+static FILE *out;						//merged stream
+static speed_t baud = B9600;
+static volatile sig_atomic_t quit = 0;	//1->terminate
+static shr_t ring;						//shared-memory ring, ring.h == NULL -> not in use
+static lsn_t lsn[2] = {{EP_LISTEN, -1}, {EP_LISTEN, -1}};	//unix / tcp listening sockets
+static sub_t sub[SUB_MAX];				//subscribers
+static int nsub;						//highest slot in use + 1
+static int ep;							//epoll set
+
+static void on_signal(int sig) {quit = 1;}
+
+//baud rate constant
+static speed_t baud_code(long b) {
+	switch (b) {
+		case 1200: return B1200; case 2400: return B2400; case 4800: return B4800;
+		case 9600: return B9600; case 19200: return B19200; case 38400: return B38400;
+		case 57600: return B57600; case 115200: return B115200; case 230400: return B230400;
+		case 460800: return B460800; case 921600: return B921600;
+		default: return 0;
+	}
+}
+
+//open a device: raw, non-blocking, and add it to the epoll set
+static int dev_open(int ep, chan_t *d) {
+	struct epoll_event ev;
+	struct termios tio;
+
+	if ((d->fd = open(d->path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)) < 0) return -1;
+	if (tcgetattr(d->fd, &tio) == 0) {	//a tty: raw mode at the baud rate. plain files / fifos are read as they are
+		cfmakeraw(&tio);
+		cfsetspeed(&tio, baud);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tio.c_cc[VMIN] = 1; tio.c_cc[VTIME] = 0;
+		tcsetattr(d->fd, TCSANOW, &tio);
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = d;
+	if (epoll_ctl(ep, EPOLL_CTL_ADD, d->fd, &ev)) {close(d->fd); d->fd = -1; return -1;}
+	d->n = d->fn = 0;
+	return 0;
+}
+
+static void dev_close(int ep, chan_t *d) {
+	epoll_ctl(ep, EPOLL_CTL_DEL, d->fd, NULL);
+	close(d->fd);
+	d->fd = -1;
+}
+
+//listen on a unix-domain socket (port < 0) or a loopback tcp port
+static int sub_listen(lsn_t *l, const char *path, int port) {
+	struct sockaddr_un un = {.sun_family = AF_UNIX};
+	struct sockaddr_in in = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+	struct epoll_event ev = {.events = EPOLLIN, .data.ptr = l};
+	int on = 1;
+
+	if ((l->fd = socket((port < 0) ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) return -1;
+	if (port < 0) {
+		strncpy(un.sun_path, path, sizeof(un.sun_path) - 1);
+		unlink(path);					//left over from an earlier run
+		if (bind(l->fd, (struct sockaddr *) &un, sizeof(un))) return -1;
+	} else {
+		setsockopt(l->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (bind(l->fd, (struct sockaddr *) &in, sizeof(in))) return -1;
+	}
+	if (listen(l->fd, 16)) return -1;
+	return epoll_ctl(ep, EPOLL_CTL_ADD, l->fd, &ev);
+}
+
+static void sub_close(sub_t *s) {
+	epoll_ctl(ep, EPOLL_CTL_DEL, s->fd, NULL);
+	close(s->fd);
+	s->fd = -1;
+	free(s->want); free(s->buf);
+	while (nsub && sub[nsub - 1].fd < 0) nsub -= 1;
+}
+
+//new subscriber(s)
+static void sub_accept(lsn_t *l) {
+	struct epoll_event ev = {.events = EPOLLIN};
+	sub_t *s;
+	int fd, i;
+
+	while ((fd = accept4(l->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		for (i = 0; i < SUB_MAX && sub[i].fd >= 0; i++) continue;
+		if (i == SUB_MAX) {close(fd); continue;}	//full: turned away
+		s = &sub[i];
+		s->type = EP_SUB; s->fd = fd;
+		s->want = malloc(ndev); s->buf = malloc(SUB_BUF);
+		s->in_n = s->n = s->drop = 0; s->pollout = 0;
+		ev.data.ptr = s;
+		if (s->want == NULL || s->buf == NULL || epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev)) {
+			free(s->want); free(s->buf); close(fd); s->fd = -1;
+			continue;
+		}
+		memset(s->want, SUB_FREQ, ndev);	//default: all readings
+		if (i >= nsub) nsub = i + 1;
+	}
+}
+
+//one command from a subscriber: "sub device|* freq|all|none"
+static void sub_command(sub_t *s, char *cmd) {
+	char name[64], what[8];
+	int i, w;
+
+	if (sscanf(cmd, "sub %63s %7s", name, what) != 2) return;	//unknown: ignored
+	if (strcmp(what, "freq") == 0) w = SUB_FREQ;
+	else if (strcmp(what, "all") == 0) w = SUB_FREQ | SUB_OTHER;
+	else if (strcmp(what, "none") == 0) w = 0;
+	else return;
+	for (i = 0; i < ndev; i++) if (strcmp(name, "*") == 0 || strcmp(name, dev[i].name) == 0) s->want[i] = w;
+}
+
+//bytes received from a subscriber
+static void sub_rx(sub_t *s) {
+	char buf[256];
+	ssize_t n, i;
+
+	while ((n = read(s->fd, buf, sizeof(buf))) > 0)
+		for (i = 0; i < n; i++) {
+			if (buf[i] == '\n' || buf[i] == '\r') {
+				s->in[s->in_n] = 0;
+				if (s->in_n) sub_command(s, s->in);
+				s->in_n = 0;
+			} else if (s->in_n < sizeof(s->in) - 1) s->in[s->in_n++] = buf[i];
+		}
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) sub_close(s);	//gone
+}
+
+//send what the subscriber will take, and wait for EPOLLOUT if that isn't all
+static void sub_tx(sub_t *s) {
+	struct epoll_event ev = {.data.ptr = s};
+	ssize_t k;
+
+	if (s->drop && s->n < SUB_BUF - 32)	//caught up a little: tell it what it missed
+		{s->n += snprintf(s->buf + s->n, 32, "# dropped %llu\n", (unsigned long long) s->drop); s->drop = 0;}
+	if (s->n && (k = write(s->fd, s->buf, s->n)) > 0) {
+		memmove(s->buf, s->buf + k, s->n - k);
+		s->n -= k;
+	} else if (s->n && errno != EAGAIN && errno != EINTR) {sub_close(s); return;}
+	if ((s->n != 0) != s->pollout) {	//only when it changes: one syscall per subscriber per batch otherwise
+		s->pollout = (s->n != 0);
+		ev.events = EPOLLIN | (s->pollout ? EPOLLOUT : 0);
+		epoll_ctl(ep, EPOLL_CTL_MOD, s->fd, &ev);
+	}
+}
+
+//queue a line for the subscribers that want it, dropping it for those that are full
+static void sub_put(int d, int what, const char *s, size_t n) {
+	int i;
+
+	for (i = 0; i < nsub; i++) {
+		if (sub[i].fd < 0 || (sub[i].want[d] & what) == 0) continue;
+		if (sub[i].n + n > SUB_BUF - 32) {sub[i].drop += 1; continue;}	//room kept for the notice
+		memcpy(sub[i].buf + sub[i].n, s, n);
+		sub[i].n += n;
+	}
+}
+
+//write one line of a device to the merged stream
+static void emit(chan_t *d, const char *s, size_t n) {
+	fl_rec_t fl;
+	shr_rec_t rec;
+	char l[LINE_MAX + 64];
+	int k, r = 0;
+
+	fprintf(out, "[%lld.%09ld] %s %.*s\n", (long long) d->ts.tv_sec, d->ts.tv_nsec, d->name, (int) n, s);
+	if ((ring.h || nsub) && (r = fl_parse_line(s, s + n, &fl)) && ring.h) {	//a reading: published, stamped with its utc tag or its time of arrival
+		rec.ts = (fl.ts != FL_NOTS) ? fl.ts : d->ts.tv_sec * 1000000000ll + d->ts.tv_nsec;
+		rec.freq = fl.freq;
+		rec.frac = fl.frac;
+		rec.dev = d - dev;
+		shr_put(&ring, &rec);
+	}
+	if (nsub == 0) return;
+	k = r ? snprintf(l, sizeof(l), "[%lld.%09ld] %s freq = %10u.%03uHz.\n", (long long) d->ts.tv_sec, d->ts.tv_nsec, d->name, fl.freq, fl.frac) :
+		snprintf(l, sizeof(l), "[%lld.%09ld] %s %.*s\n", (long long) d->ts.tv_sec, d->ts.tv_nsec, d->name, (int) n, s);
+	sub_put(d - dev, r ? SUB_FREQ : SUB_OTHER, l, (k < (int) sizeof(l)) ? k : (int) sizeof(l) - 1);
+}
+
+//binary frame complete in d->fr: check and convert it
+static void frame(chan_t *d) {
+	uint16_t s1 = 0, s2 = 0;
+	uint32_t freq;
+	size_t i, len = d->fr[3];
+	char s[48];
+
+	for (i = 2; i < 4 + len; i++) {s1 = (s1 + d->fr[i]) % 255; s2 = (s2 + s1) % 255;}
+	if (d->fr[4 + len] != s1 || d->fr[5 + len] != s2) return;	//corrupt: dropped
+	if (d->fr[2] == FR_READING && len == 6) {
+		freq = d->fr[4] | d->fr[5] << 8 | d->fr[6] << 16 | (uint32_t) d->fr[7] << 24;
+		emit(d, s, snprintf(s, sizeof(s), "freq = %10u.%03uHz.", freq, (d->fr[8] | d->fr[9] << 8) % 1000));
+	}
+}
+
+//bytes received from a device
+static void rx(chan_t *d, const uint8_t *p, size_t n, const struct timespec *now) {
+	for (; n; p++, n--) {
+		if (d->fn) {					//in a binary frame
+			d->fr[d->fn++] = *p;
+			if (d->fn == 2 && *p != FR_SYNC1) d->fn = 0;	//not a frame after all
+			else if (d->fn > 3 && d->fn == 6u + d->fr[3]) {frame(d); d->fn = 0;}
+			continue;
+		}
+		if (*p == FR_SYNC0 && d->n == 0) {d->fr[0] = *p; d->fn = 1; d->ts = *now; continue;}
+		if (*p == '\n' || *p == '\r') {	//end of a line: "\n\r" from the firmware, blank lines skipped
+			if (d->n) emit(d, d->line, d->n);
+			d->n = 0;
+			continue;
+		}
+		if (d->n == 0) d->ts = *now;	//first byte of a line
+		if (d->n < LINE_MAX) d->line[d->n++] = *p;
+	}
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: aggd [-b baud] [-o out_file] [-m shm_name] [-n slots] [-s socket_path] [-t tcp_port] device...\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	struct epoll_event ev[EV_MAX];
+	struct timespec now;
+	uint8_t buf[4096];
+	int opt, i, k, port = -1;
+	int64_t retry = 0;
+	const char *name, *shm = NULL, *sock = NULL;
+	uint32_t slots = SHR_SLOTS;
+	ssize_t n;
+
+	out = stdout;
+	while ((opt = getopt(argc, argv, "b:o:m:n:s:t:h")) != -1) {
+		switch (opt) {
+			case 'b': if ((baud = baud_code(strtol(optarg, NULL, 0))) == 0) usage(); break;
+			case 'o': if ((out = fopen(optarg, "a")) == NULL) {perror(optarg); return 1;} break;
+			case 'm': shm = optarg; break;
+			case 'n': slots = strtoul(optarg, NULL, 0); break;
+			case 's': sock = optarg; break;
+			case 't': port = atoi(optarg); break;
+			default: usage();
+		}
+	}
+	if (optind == argc) usage();
+	signal(SIGINT, on_signal); signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);			//subscribers that go away: seen as write errors
+	if ((ep = epoll_create1(EPOLL_CLOEXEC)) < 0) {perror("epoll"); return 1;}
+	if (shm && shr_create(&ring, shm, slots)) {perror(shm); return 1;}
+	if (sock && sub_listen(&lsn[0], sock, -1)) {perror(sock); return 1;}
+	if (port >= 0 && sub_listen(&lsn[1], NULL, port)) {perror("tcp"); return 1;}
+	for (i = 0; i < SUB_MAX; i++) sub[i].fd = -1;
+	ndev = argc - optind;
+	dev = calloc(ndev, sizeof(chan_t));
+	for (i = 0; i < ndev; i++) {
+		dev[i].type = EP_DEV;
+		dev[i].path = argv[optind + i];
+		dev[i].name = (name = strrchr(dev[i].path, '/')) ? name + 1 : dev[i].path;
+		if (ring.h) shr_setname(&ring, i, dev[i].name);
+		if (dev_open(ep, &dev[i])) perror(dev[i].path);	//not there yet: reopened later
+	}
+
+	while (!quit) {
+		k = epoll_wait(ep, ev, EV_MAX, REOPEN_MS);
+		if (k < 0 && errno != EINTR) {perror("epoll_wait"); break;}
+		clock_gettime(CLOCK_REALTIME, &now);	//one time of arrival per wakeup: the devices are read right away
+		for (i = 0; i < k; i++) {
+			switch (*(int *) ev[i].data.ptr) {
+			case EP_DEV: {
+				chan_t *d = ev[i].data.ptr;
+				while ((n = read(d->fd, buf, sizeof(buf))) > 0) rx(d, buf, n, &now);
+				if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR) || (ev[i].events & (EPOLLHUP | EPOLLERR)))
+					dev_close(ep, d);	//gone: reopened later
+				break;
+			}
+			case EP_LISTEN: sub_accept(ev[i].data.ptr); break;
+			case EP_SUB: {
+				sub_t *s = ev[i].data.ptr;
+				if (s->fd >= 0 && (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) sub_rx(s);	//EPOLLOUT: sent below
+				break;
+			}
+			}
+		}
+		fflush(out);					//a batch at a time, not a line at a time
+		for (i = 0; i < nsub; i++) if (sub[i].fd >= 0 && (sub[i].n || sub[i].drop)) sub_tx(&sub[i]);
+		if (now.tv_sec * 1000ll + now.tv_nsec / 1000000 - retry >= REOPEN_MS) {	//retry the devices that are closed
+			retry = now.tv_sec * 1000ll + now.tv_nsec / 1000000;
+			for (i = 0; i < ndev; i++) if (dev[i].fd < 0) dev_open(ep, &dev[i]);
+		}
+	}
+	fflush(out);
+	if (ring.h) shr_close(&ring, shm, 1);	//readers still attached keep their mapping
+	if (sock) unlink(sock);
+	return 0;
+}
@@ -0,0 +1,88 @@
+//source file for the columnar store of frequency readings
+
+#include <stdio.h>						//we use fopen
+#include <stdlib.h>						//we use malloc
+#include <string.h>						//we use memcpy
+#include <errno.h>						//we use errno
+#include "colstore.h"					//we use columnar store
+
+//global defines
+#define CS_ALIGN(x)			(((x) + 7) & ~(size_t) 7)
+
+//global variables
+static const uint8_t cs_zero[8];		//padding
+
+//offset of a column in the file
+size_t cs_off(size_t n, int col) {
+	size_t off = CS_HDR;
+
+	if (col > 0) off = CS_ALIGN(off + n * sizeof(int64_t));
+	if (col > 1) off = CS_ALIGN(off + n * sizeof(uint32_t));
+	if (col > 2) off = CS_ALIGN(off + n * sizeof(uint16_t));
+	return off;
+}
+
+//allocate the columns
+int cs_alloc(cs_t *cs, size_t n) {
+	cs->n = n;
+	cs->ts = malloc(n * sizeof(int64_t) + 1);
+	cs->freq = malloc(n * sizeof(uint32_t) + 1);
+	cs->frac = malloc(n * sizeof(uint16_t) + 1);
+	if (cs->ts && cs->freq && cs->frac) return 0;
+	cs_free(cs);
+	return -1;
+}
+
+//release the columns
+void cs_free(cs_t *cs) {
+	free(cs->ts); free(cs->freq); free(cs->frac);
+	cs->ts = NULL; cs->freq = NULL; cs->frac = NULL;
+	cs->n = 0;
+}
+
+//one column, padded to the next 8-byte boundary
+static int cs_col(FILE *fp, const void *p, size_t size) {
+	if (fwrite(p, 1, size, fp) != size) return -1;
+	return (fwrite(cs_zero, 1, CS_ALIGN(size) - size, fp) == CS_ALIGN(size) - size) ? 0 : -1;
+}
+
+//write a table
+int cs_write(const char *path, const cs_t *cs) {
+	uint8_t hdr[CS_HDR] = {0};
+	uint32_t magic = CS_MAGIC;
+	uint16_t ver = CS_VER, cols = CS_COLS;
+	uint64_t n = cs->n;
+	FILE *fp;
+	int err;
+
+	memcpy(hdr, &magic, 4); memcpy(hdr + 4, &ver, 2); memcpy(hdr + 6, &cols, 2); memcpy(hdr + 8, &n, 8);
+	if ((fp = fopen(path, "wb")) == NULL) return -1;
+	err = fwrite(hdr, 1, CS_HDR, fp) != CS_HDR ||
+		cs_col(fp, cs->ts, n * sizeof(int64_t)) ||
+		cs_col(fp, cs->freq, n * sizeof(uint32_t)) ||
+		cs_col(fp, cs->frac, n * sizeof(uint16_t));
+	if (fclose(fp)) err = 1;
+	return err ? -1 : 0;
+}
+
+//read a table
+int cs_read(const char *path, cs_t *cs) {
+	uint8_t hdr[CS_HDR];
+	uint32_t magic;
+	uint16_t ver, cols;
+	uint64_t n;
+	FILE *fp;
+	int err;
+
+	if ((fp = fopen(path, "rb")) == NULL) return -1;
+	if (fread(hdr, 1, CS_HDR, fp) != CS_HDR) {fclose(fp); errno = EINVAL; return -1;}
+	memcpy(&magic, hdr, 4); memcpy(&ver, hdr + 4, 2); memcpy(&cols, hdr + 6, 2); memcpy(&n, hdr + 8, 8);
+	if (magic != CS_MAGIC || ver != CS_VER || cols != CS_COLS) {fclose(fp); errno = EINVAL; return -1;}
+	if (cs_alloc(cs, n)) {fclose(fp); errno = ENOMEM; return -1;}
+	err = fseek(fp, cs_off(n, 0), SEEK_SET) || fread(cs->ts, sizeof(int64_t), n, fp) != n ||
+		fseek(fp, cs_off(n, 1), SEEK_SET) || fread(cs->freq, sizeof(uint32_t), n, fp) != n ||
+		fseek(fp, cs_off(n, 2), SEEK_SET) || fread(cs->frac, sizeof(uint16_t), n, fp) != n;
+	fclose(fp);
+	if (err) {cs_free(cs); errno = EINVAL; return -1;}
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef COLSTORE_H_INCLUDED
+#define COLSTORE_H_INCLUDED
+
+#include <stdint.h>						//we use int64_t
+#include <stddef.h>						//we use size_t
+
+//columnar file of frequency readings, little-endian:
+//  header, 32 bytes: magic "PPSC", version (u16), number of columns (u16), number of rows (u64), 16 bytes reserved
+//  ts[n]   int64, ns since the epoch, INT64_MIN -> no timestamp
+//  freq[n] uint32, Hz, integer part
+//  frac[n] uint16, 1/1000 Hz
+//each column starts 8-byte aligned, so a mapped file can be used in place
+
+//global defines
+#define CS_MAGIC				0x43535050ul		//"PPSC"
+#define CS_VER					1
+#define CS_COLS					3
+#define CS_HDR					32					//header size, bytes
+
+//a table of readings, one array per column
+typedef struct {
+	size_t n;							//rows
+	int64_t *ts;						//timestamps
+	uint32_t *freq;						//integer part
+	uint16_t *frac;						//fractional part
+} cs_t;
+
+//global variables
+
+//allocate the columns for n rows. return 0 if successful
+int cs_alloc(cs_t *cs, size_t n);
+
+//release the columns
+void cs_free(cs_t *cs);
+
+//write a table to a file. return 0 if successful, -1 otherwise (errno set)
+int cs_write(const char *path, const cs_t *cs);
+
+//read a table from a file, allocating its columns. return 0 if successful, -1 otherwise
+int cs_read(const char *path, cs_t *cs);
+
+//offset of a column in the file, bytes
+size_t cs_off(size_t n, int col);
+
+#endif /* COLSTORE_H_INCLUDED */
@@ -0,0 +1,456 @@
+//estbench.c
+//Host benchmark of the frequency estimators used by the 1pps calibrators
+//
+//Replays simulated or recorded 1pps capture streams through each estimator and
+//reports, one csv row per estimator / setting / scenario:
+//  - throughput (samples/s), ns and cycles per sample, state memory
+//  - steady-state mean / rms error, in ppb
+//  - time-to-converge after start-up and after a frequency step, in seconds
+//  - allan deviation of the estimate at 1 sample, steady state, in ppb
+//
+//Usage:
+//  estbench [-n samples] [-f f_nom] [-j jitter_ns] [-q rcv_clk_ns] [-t thresh_ppb] [-s seed]
+//           [-r capture_file] [-e name[:param]]...
+//
+//  -e can be repeated; name is one of the estimators listed by -h, param is its
+//  knob (FREQ_CNT for ema, PPS_CNT for gate, window for linreg, -log2 of the
+//  frequency process noise for kalman).
+//  -q adds the gps receiver's quantization error to the simulated 1pps: each pulse comes out
+//  on the next edge of the receiver's clock, of this period (e.g. 20.833 for 48MHz), late by
+//  a sawtooth it reports as qErr. kalmanq takes qErr out, the others can't. that pays off once a
+//  timer tick is finer than the receiver's clock: with a coarser tick (e.g. 25ns at 40MHz vs 20.8ns)
+//  the timer's own quantization dominates, and the sawtooth merely dithers it.
+//  -r replays a recorded stream: one capture (timer ticks, decimal) per line, optionally
+//  followed by its qErr (ps).
+//  The reference for a recorded stream is its overall least-squares frequency.
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use uint32_t
+#include <string.h>						//we use strcmp
+#include <math.h>						//we use sqrt
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include "kalman.h"						//we use kalman filter
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>					//we use __rdtsc
+#define CYCLES()	__rdtsc()
+#else
+#define CYCLES()	0
+#endif
+
+//global defines
+#define F_NOM		10000000ul			//default nominal timebase frequency, ticks/s
+#define SAMPLES		20000				//default number of simulated 1pps captures
+#define JITTER_NS	20.0				//default 1pps jitter, ns rms
+#define THRESH_PPB	200.0				//default convergence threshold, ppb
+#define LR_MAX		512					//max. linreg window
+#define EST_MAX		32					//max. number of estimator settings per run
+#define RUN_NS		100000000ll			//min. time spent on timing an estimator, ns
+#define RCV_Y		2.5e-9				//simulated receiver clock offset: sets how fast the sawtooth runs
+
+//estimator interface
+//init: reset the estimator, seeded with the nominal frequency
+//update: feed a raw capture and its qErr (ps, 0 if none), return 1 if *f_est was updated
+typedef struct {
+	const char *name;					//estimator name
+	int32_t param;						//default parameter
+	const char *knob;					//what param means
+	size_t size;						//size of the state
+	size_t (*mem)(int32_t param);		//memory actually used by the state
+	void (*init)(void *st, int32_t param, uint32_t f_nom);
+	int  (*update)(void *st, uint32_t tick, int32_t qerr, double *f_est);
+} est_t;
+
+//test scenario
+typedef struct {
+	const char *name;					//scenario name
+	double y0;							//initial fractional frequency offset
+	double drift;						//linear frequency drift, 1/s
+	double step;						//fractional frequency step
+	double step_at;						//fraction of the run at which the step occurs, <0 -> no step
+} scen_t;
+
+//one estimator setting
+typedef struct {
+	const est_t *est;					//estimator
+	int32_t param;						//its parameter
+} setting_t;
+
+//global variables
+static uint32_t f_nom = F_NOM;			//nominal timebase frequency
+static double jitter_ns = JITTER_NS;	//1pps jitter
+static double saw_ns = 0;				//receiver clock period, 0->no quantization error
+static double thresh_ppb = THRESH_PPB;	//convergence threshold
+static uint64_t rnd_state = 88172645463325252ull;	//prng state
+static volatile double sink;			//keeps the timing loops honest
+
+//------------------------------------------------------------------------------
+//ema: FREQ_CNT-weighted exponential average over freq_sum, as in main.c
+typedef struct {
+	int32_t freq_cnt;					//weight
+	uint32_t tick0;						//previous capture
+	int32_t freq_sum, freq_avg;			//running sum / average
+	uint8_t first;						//1->no capture yet
+} ema_t;
+
+static size_t ema_mem(int32_t param) { return sizeof(ema_t); }
+
+static void ema_init(void *p, int32_t param, uint32_t f_nom) {
+	ema_t *st = p;
+	st->freq_cnt = param;
+	st->freq_sum = f_nom * param;		//initialize freq_sum from the nominal frequency
+	st->freq_avg = f_nom;
+	st->first = 1;
+}
+
+static int ema_update(void *p, uint32_t tick, int32_t qerr, double *f_est) {
+	ema_t *st = p;
+	int32_t freq;
+
+	if (st->first) {st->first = 0; st->tick0 = tick; return 0;}
+	freq = tick - st->tick0; st->tick0 = tick;	//isr: 32-bit capture difference
+	st->freq_sum += freq - st->freq_avg;		//main loop: smoothing the reading
+	st->freq_avg = st->freq_sum / st->freq_cnt;
+	*f_est = (double) st->freq_sum / st->freq_cnt;	//freq_avg + freq_f / FREQ_CNT
+	return 1;
+}
+
+//gate: PPS_CNT gating, one reading per PPS_CNT pulses
+typedef struct {
+	int32_t pps_cnt, cnt;				//gate length / current count, downcounter
+	uint32_t tick0;						//capture that opened the gate
+	uint8_t first;						//1->no capture yet
+} gate_t;
+
+static size_t gate_mem(int32_t param) { return sizeof(gate_t); }
+
+static void gate_init(void *p, int32_t param, uint32_t f_nom) {
+	gate_t *st = p;
+	st->pps_cnt = st->cnt = param;
+	st->first = 1;
+}
+
+static int gate_update(void *p, uint32_t tick, int32_t qerr, double *f_est) {
+	gate_t *st = p;
+
+	if (st->first) {st->first = 0; st->tick0 = tick; return 0;}
+	if (--st->cnt) return 0;			//gate still open
+	st->cnt = st->pps_cnt;
+	*f_est = (double) (uint32_t) (tick - st->tick0) / st->pps_cnt;
+	st->tick0 = tick;
+	return 1;
+}
+
+//linreg: least-squares slope over a sliding window of captures
+//o(1) per sample: running sums of y-base and i*(y-base), base = oldest sample in the window
+typedef struct {
+	int32_t w, n, head;					//window size, samples in window, oldest sample
+	uint32_t tick0;						//previous capture
+	int64_t y, base;					//unwrapped timestamp of the latest / oldest capture
+	int64_t s0, s1;						//sum(y-base), sum(i*(y-base)), i=0 for the oldest sample
+	int64_t buf[LR_MAX];				//window
+} linreg_t;
+
+static size_t linreg_mem(int32_t param) { return sizeof(linreg_t) - sizeof(int64_t) * (LR_MAX - param); }
+
+static void linreg_init(void *p, int32_t param, uint32_t f_nom) {
+	linreg_t *st = p;
+	st->w = (param < 2) ? 2 : (param > LR_MAX) ? LR_MAX : param;
+	st->n = st->head = 0;
+	st->s0 = st->s1 = 0;
+	st->y = st->base = 0;
+}
+
+static int linreg_update(void *p, uint32_t tick, int32_t qerr, double *f_est) {
+	linreg_t *st = p;
+	int64_t r, d, sx, sxx, n;
+
+	if (st->n) st->y += (uint32_t) (tick - st->tick0);	//unwrap
+	st->tick0 = tick;
+	r = st->y - st->base;
+	if (st->n < st->w) {				//window still filling
+		st->buf[st->n] = st->y;
+		st->s0 += r; st->s1 += st->n * r;
+		st->n += 1;
+	} else {							//slide: drop the oldest (r=0), shift the indices down by one
+		st->s1 += (int64_t) (st->w - 1) * r - st->s0;
+		st->s0 += r;
+		st->buf[st->head] = st->y;
+		st->head = (st->head + 1) % st->w;
+		d = st->buf[st->head] - st->base;	//rebase on the new oldest sample
+		st->s0 -= st->w * d;
+		st->s1 -= (int64_t) st->w * (st->w - 1) / 2 * d;
+		st->base += d;
+	}
+	if ((n = st->n) < 2) return 0;
+	sx  = n * (n - 1) / 2;				//sum(i)
+	sxx = (n - 1) * n * (2 * n - 1) / 6;	//sum(i*i)
+	*f_est = (double) (n * st->s1 - sx * st->s0) / (double) (n * sxx - sx * sx);
+	return 1;
+}
+
+//kalman: three-state fixed-point filter from kalman.c
+//param sets the frequency process noise, q1 = 2^-param (ticks/gate)^2 per gate, drift noise q2 = q1 / 2^16
+//measurement noise follows the simulated capture noise: quantization + 1pps jitter + the receiver's sawtooth
+//kalmanq: the same, with qErr taken out of each interval by kf_update_c(). r is the same for both,
+//so they have the same bandwidth. not in the firmware: it only pays with a tick finer than the receiver's clock
+typedef struct {
+	kf_t kf;							//filter
+	uint32_t tick0;						//previous capture
+	int32_t qerr0;						//its qErr
+	uint8_t corr;						//1->qErr taken out
+	uint8_t first;						//number of captures still needed before the filter starts
+} kalman_t;
+
+static size_t kalman_mem(int32_t param) { return sizeof(kalman_t); }
+
+static void kalman_reset(kalman_t *st, int32_t param, uint32_t f_nom, uint8_t corr) {
+	double saw = saw_ns * 1e-9 * f_nom;
+
+	st->first = 2;
+	st->corr = corr;
+	st->qerr0 = 0;
+	kf_init(&st->kf, f_nom);
+	st->kf.q[1] = KF_Q32(1) >> param;
+	st->kf.q[2] = st->kf.q[1] >> 16;
+	st->kf.r = KF_Q32(1.0 / 12 + (jitter_ns * 1e-9 * f_nom) * (jitter_ns * 1e-9 * f_nom) + saw * saw / 12);
+}
+
+static void kalman_init(void *p, int32_t param, uint32_t f_nom) { kalman_reset(p, param, f_nom, 0); }
+
+static void kalmanq_init(void *p, int32_t param, uint32_t f_nom) { kalman_reset(p, param, f_nom, 1); }
+
+static int kalman_update(void *p, uint32_t tick, int32_t qerr, double *f_est) {
+	kalman_t *st = p;
+	int64_t q1 = st->kf.q[1], q2 = st->kf.q[2], r = st->kf.r;
+	uint32_t frac;
+	int32_t freq, dq;
+
+	freq = tick - st->tick0; st->tick0 = tick;
+	dq = qerr - st->qerr0; st->qerr0 = qerr;
+	if (st->first) {					//seed the filter with the first interval
+		if (--st->first) return 0;
+		kf_init(&st->kf, freq);
+		st->kf.q[1] = q1; st->kf.q[2] = q2; st->kf.r = r;
+	} else if (st->corr) kf_update_c(&st->kf, freq, -(int64_t) dq * st->kf.n * 4295 / 1000000);	//as qerr_corr() in the firmware
+	else kf_update(&st->kf, freq);
+	freq = kf_freq(&st->kf, &frac);
+	*f_est = freq + frac / 4294967296.0;
+	return 1;
+}
+
+//estimator table
+static const est_t est_tbl[] = {
+	{"ema",    10, "FREQ_CNT", sizeof(ema_t),    ema_mem,    ema_init,    ema_update},
+	{"gate",    1, "PPS_CNT",  sizeof(gate_t),   gate_mem,   gate_init,   gate_update},
+	{"linreg", 32, "window",   sizeof(linreg_t), linreg_mem, linreg_init, linreg_update},
+	{"kalman", 14, "-log2(q1)", sizeof(kalman_t), kalman_mem, kalman_init, kalman_update},
+	{"kalmanq",14, "-log2(q1)", sizeof(kalman_t), kalman_mem, kalmanq_init, kalman_update},
+};
+#define EST_CNT		(sizeof(est_tbl) / sizeof(est_tbl[0]))
+
+//default settings when no -e is given
+static const char *est_def[] = {"ema:4", "ema:10", "ema:32", "gate:1", "gate:2", "gate:10", "linreg:8", "linreg:32", "linreg:128", "kalman:10", "kalman:14", "kalman:18", "kalmanq:14"};
+
+//simulated scenarios
+static const scen_t scen_tbl[] = {
+	{"static",  15e-6,    0,     0,  -1},	//start-up from a 15ppm offset
+	{"step",        0,    0,  1e-6, 0.5},	//1ppm step half way through
+	{"drift",       0, 1e-9,     0,  -1},	//aging / warming: 1ppb/s
+};
+#define SCEN_CNT	(sizeof(scen_tbl) / sizeof(scen_tbl[0]))
+
+//------------------------------------------------------------------------------
+//xorshift64* prng
+static double rnd_uniform(void) {
+	rnd_state ^= rnd_state >> 12; rnd_state ^= rnd_state << 25; rnd_state ^= rnd_state >> 27;
+	return ((rnd_state * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//gaussian, box-muller
+static double rnd_gauss(void) {
+	double u1, u2;
+	do u1 = rnd_uniform(); while (u1 <= 0);
+	u2 = rnd_uniform();
+	return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//generate n captures for scenario sc into tick[], their qErr into qerr[], true frequency into f_true[]
+//with saw_ns, the receiver's pulse comes out on the next edge of its clock: late by e, reported as qErr
+static void sim_gen(const scen_t *sc, size_t n, uint32_t *tick, int32_t *qerr, double *f_true) {
+	double t, ts, ph, off, e = 0;
+	double rph = rnd_uniform(), rinc = (saw_ns > 0) ? fmod(1e9 * (1 + RCV_Y) / saw_ns, 1.0) : 0;	//second's position in a receiver clock cycle, its advance per second
+	size_t k;
+
+	ts  = (sc->step_at < 0) ? 1e300 : sc->step_at * n;
+	off = 4294967296.0 - 2.5 * f_nom;	//start close to the wrap-around
+	for (k = 0; k < n; k++) {
+		if (saw_ns > 0) {e = (1 - rph) * saw_ns; rph += rinc; if (rph >= 1) rph -= 1;}
+		qerr[k] = lround(e * 1000);
+		t  = k + (e + jitter_ns * rnd_gauss()) * 1e-9;	//1pps edge, with the sawtooth and jitter
+		ph = t + sc->y0 * t + sc->drift * t * t / 2 + ((t > ts) ? sc->step * (t - ts) : 0);
+		tick[k] = (uint32_t) (uint64_t) floor(off + f_nom * ph);	//timer is quantized and wraps
+		f_true[k] = f_nom * (1 + sc->y0 + sc->drift * k + ((k >= ts) ? sc->step : 0));
+	}
+}
+
+//load a recorded stream; the reference is its least-squares frequency
+static size_t rec_load(const char *fname, uint32_t **tick, int32_t **qerr, double **f_true) {
+	FILE *fp;
+	size_t n = 0, cap = 0, k;
+	unsigned long v;
+	long q;
+	int m;
+	char line[128];
+	double y = 0, sy = 0, sky = 0, sk, skk, f;
+	uint32_t *tk = NULL;
+	int32_t *qk = NULL;
+
+	if ((fp = fopen(fname, "r")) == NULL) {perror(fname); exit(1);}
+	while (fgets(line, sizeof(line), fp) && (m = sscanf(line, "%lu %ld", &v, &q)) >= 1) {
+		if (n == cap) {cap = cap ? cap * 2 : 4096; tk = realloc(tk, cap * sizeof(*tk)); qk = realloc(qk, cap * sizeof(*qk));}
+		qk[n] = (m == 2) ? q : 0;
+		tk[n++] = v;
+	}
+	fclose(fp);
+	if (n < 3) {fprintf(stderr, "%s: too few captures\n", fname); exit(1);}
+	for (k = 0; k < n; k++) {
+		if (k) y += (uint32_t) (tk[k] - tk[k - 1]);
+		sy += y; sky += k * y;
+	}
+	sk = n * (n - 1) / 2.0; skk = (n - 1) * n * (2 * n - 1) / 6.0;
+	f = (n * sky - sk * sy) / (n * skk - sk * sk);
+	*f_true = malloc(n * sizeof(double));
+	for (k = 0; k < n; k++) (*f_true)[k] = f;
+	*tick = tk;
+	*qerr = qk;
+	return n;
+}
+
+//time-to-converge in [from, to): samples until |err| stays below the threshold, -1 if it never does
+static double conv_time(const double *err, size_t from, size_t to) {
+	size_t k = to;
+
+	while (k > from && fabs(err[k - 1]) < thresh_ppb) k--;
+	return (k == to) ? -1 : (double) (k - from);
+}
+
+//run one setting over one stream and print a csv row
+static void bench(const setting_t *s, const char *scen, double step_at, size_t n, const uint32_t *tick, const int32_t *qerr, const double *f_true) {
+	void *st = malloc(s->est->size);
+	double *err = malloc(n * sizeof(double));
+	double f_est, sum, sum2, sumd = 0, acc = 0;
+	int64_t t0, t1, c0, c1, runs = 0;
+	size_t k, ss0, step;
+
+	//accuracy pass
+	s->est->init(st, s->param, f_nom);
+	f_est = f_nom;						//seeded with the nominal value
+	for (k = 0; k < n; k++) {
+		s->est->update(st, tick[k], qerr[k], &f_est);
+		err[k] = (f_est - f_true[k]) / f_true[k] * 1e9;
+	}
+	//timing pass
+	t0 = now_ns(); c0 = CYCLES();
+	do {
+		s->est->init(st, s->param, f_nom);
+		for (k = 0; k < n; k++) if (s->est->update(st, tick[k], qerr[k], &f_est)) acc += f_est;
+		runs += 1;
+	} while ((t1 = now_ns()) - t0 < RUN_NS);
+	c1 = CYCLES();
+	sink = acc;
+
+	//steady state: last quarter of the run
+	ss0 = n - n / 4; sum = sum2 = 0;
+	for (k = ss0; k < n; k++) {sum += err[k]; sum2 += err[k] * err[k];}
+	for (k = ss0 + 1; k < n; k++) sumd += (err[k] - err[k - 1]) * (err[k] - err[k - 1]);	//adev at 1 sample: the reference's own changes cancel out
+	step = (step_at < 0) ? n : (size_t) (step_at * n);
+	printf("%s,%d,%s,%zu,%.0f,%.2f,%.1f,%zu,%.3f,%.3f,%.0f,%.0f,%.4f\n",
+		s->est->name, s->param, scen, n,
+		(double) runs * n * 1e9 / (t1 - t0),
+		(double) (t1 - t0) / (runs * n),
+		(double) (c1 - c0) / (runs * n),
+		s->est->mem(s->param),
+		sum / (n - ss0), sqrt(sum2 / (n - ss0)),
+		conv_time(err, 0, step),
+		(step < n) ? conv_time(err, step, n) : -1.0,
+		sqrt(sumd / (2 * (n - ss0 - 1))));
+	free(err); free(st);
+}
+
+//parse name[:param]
+static int setting_parse(const char *str, setting_t *s) {
+	size_t i, len = strcspn(str, ":");
+
+	for (i = 0; i < EST_CNT; i++)
+		if (strlen(est_tbl[i].name) == len && strncmp(est_tbl[i].name, str, len) == 0) {
+			s->est = &est_tbl[i];
+			s->param = str[len] ? atoi(str + len + 1) : est_tbl[i].param;
+			return (s->param > 0) ? 0 : -1;
+		}
+	return -1;
+}
+
+static void usage(void) {
+	size_t i;
+	fprintf(stderr, "usage: estbench [-n samples] [-f f_nom] [-j jitter_ns] [-q rcv_clk_ns] [-t thresh_ppb] [-s seed] [-r capture_file] [-e name[:param]]...\n");
+	fprintf(stderr, "estimators:\n");
+	for (i = 0; i < EST_CNT; i++) fprintf(stderr, "  %-8s param = %s, default %d\n", est_tbl[i].name, est_tbl[i].knob, est_tbl[i].param);
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	setting_t set[EST_MAX];
+	size_t nset = 0, n = SAMPLES, i, j;
+	const char *rec = NULL;
+	uint32_t *tick;
+	int32_t *qerr;
+	double *f_true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:f:j:q:t:s:r:e:h")) != -1) {
+		switch (opt) {
+			case 'n': n = strtoul(optarg, NULL, 0); break;
+			case 'f': f_nom = strtoul(optarg, NULL, 0); break;
+			case 'j': jitter_ns = atof(optarg); break;
+			case 'q': saw_ns = atof(optarg); break;
+			case 't': thresh_ppb = atof(optarg); break;
+			case 's': rnd_state = strtoull(optarg, NULL, 0) | 1; break;
+			case 'r': rec = optarg; break;
+			case 'e':
+				if (nset == EST_MAX || setting_parse(optarg, &set[nset])) usage();
+				nset += 1;
+				break;
+			default: usage();
+		}
+	}
+	if (n < 8 || f_nom == 0) usage();
+	if (nset == 0)						//default settings
+		for (i = 0; i < sizeof(est_def) / sizeof(est_def[0]); i++) setting_parse(est_def[i], &set[nset++]);
+
+	printf("estimator,param,scenario,samples,samples_per_s,ns_per_sample,cycles_per_sample,state_bytes,ss_mean_ppb,ss_rms_ppb,conv_start_s,conv_step_s,adev1_ppb\n");
+	if (rec) {							//recorded stream
+		n = rec_load(rec, &tick, &qerr, &f_true);
+		for (j = 0; j < nset; j++) bench(&set[j], "recorded", -1, n, tick, qerr, f_true);
+	} else {							//simulated streams
+		tick = malloc(n * sizeof(uint32_t));
+		qerr = malloc(n * sizeof(int32_t));
+		f_true = malloc(n * sizeof(double));
+		for (i = 0; i < SCEN_CNT; i++) {
+			sim_gen(&scen_tbl[i], n, tick, qerr, f_true);
+			for (j = 0; j < nset; j++) bench(&set[j], scen_tbl[i].name, scen_tbl[i].step_at, n, tick, qerr, f_true);
+		}
+	}
+	free(tick); free(qerr); free(f_true);
+	return 0;
+}
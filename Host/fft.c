@@ -0,0 +1,55 @@
+//source file for the fft
+
+#include <stdlib.h>						//we use malloc
+#include <math.h>						//we use cos
+#include "fft.h"						//we use fft
+
+//global defines
+
+//global variables
+
+//plan an fft
+int fft_init(fft_t *f, size_t n) {
+	size_t k, b, bits = 0;
+
+	f->n = n;
+	f->w = NULL; f->rev = NULL;
+	if (n < 2 || (n & (n - 1)) || n > (1ul << 31)) return -1;
+	while ((1ul << bits) < n) bits++;
+	f->w = malloc(n / 2 * sizeof(fft_c_t));
+	f->rev = malloc(n * sizeof(uint32_t));
+	if (f->w == NULL || f->rev == NULL) {fft_free(f); return -1;}
+	for (k = 0; k < n / 2; k++) {f->w[k].re = cos(2 * M_PI * k / n); f->w[k].im = -sin(2 * M_PI * k / n);}
+	for (k = 0; k < n; k++) {
+		for (f->rev[k] = 0, b = 0; b < bits; b++) if (k & (1ul << b)) f->rev[k] |= 1u << (bits - 1 - b);
+	}
+	return 0;
+}
+
+//forward transform, in place
+void fft_run(const fft_t *f, fft_c_t *x) {
+	size_t n = f->n, len, half, step, i, j, k;
+	fft_c_t t, u, w;
+
+	for (i = 0; i < n; i++)				//bit-reversed order
+		if (f->rev[i] > i) {t = x[i]; x[i] = x[f->rev[i]]; x[f->rev[i]] = t;}
+	for (len = 2; len <= n; len <<= 1) {	//butterflies of len points
+		half = len / 2;
+		step = n / len;					//twiddle stride
+		for (i = 0; i < n; i += len)
+			for (j = 0, k = 0; j < half; j++, k += step) {
+				w = f->w[k];
+				u = x[i + j];
+				t.re = x[i + j + half].re * w.re - x[i + j + half].im * w.im;
+				t.im = x[i + j + half].re * w.im + x[i + j + half].im * w.re;
+				x[i + j].re = u.re + t.re; x[i + j].im = u.im + t.im;
+				x[i + j + half].re = u.re - t.re; x[i + j + half].im = u.im - t.im;
+			}
+	}
+}
+
+//release a plan
+void fft_free(fft_t *f) {
+	free(f->w); free(f->rev);
+	f->w = NULL; f->rev = NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef FFT_H_INCLUDED
+#define FFT_H_INCLUDED
+
+#include <stddef.h>						//we use size_t
+#include <stdint.h>						//we use uint32_t
+
+//in-place complex fft, radix-2, decimation in time, for power-of-2 sizes
+//the twiddles and the bit-reversal permutation are computed once per size by fft_init(): a plan
+//is read-only afterwards, and can be shared by any number of threads, each with its own data.
+
+//global defines
+
+//a complex number
+typedef struct {
+	double re, im;
+} fft_c_t;
+
+//a plan
+typedef struct {
+	size_t n;							//size, a power of 2
+	fft_c_t *w;							//twiddles, exp(-2 pi i k / n), k < n / 2
+	uint32_t *rev;						//bit-reversed indexes
+} fft_t;
+
+//global variables
+
+//plan an fft of size n, a power of 2 >= 2. return 0 if successful
+int fft_init(fft_t *f, size_t n);
+
+//forward transform of x[0..n), in place: X[k] = sum of x[j] exp(-2 pi i j k / n)
+void fft_run(const fft_t *f, fft_c_t *x);
+
+//release a plan
+void fft_free(fft_t *f);
+
+#endif /* FFT_H_INCLUDED */
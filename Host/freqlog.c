@@ -0,0 +1,223 @@
+//source file for the calibrator log parser
+//lines are located with memmem() on the "freq =" tag - the rest of the log is never looked at byte by byte -
+//and the digit runs are parsed 16 bytes at a time with ssse3 where the cpu has it
+
+#define _GNU_SOURCE						//we use memmem, memrchr
+#include <stdlib.h>						//we use realloc
+#include <string.h>						//we use memmem
+#include "freqlog.h"					//we use log parser
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>					//we use ssse3 intrinsics
+#define FL_X86
+#endif
+
+//global defines
+#define FL_TAG				"freq ="	//reading tag
+#define FL_TAG_LEN			6
+#define FL_UTC				"utc ="	//utc tag, after the reading
+#define FL_UTC_LEN			5
+#define FL_DIG_MAX			19			//max. number of digits in a run: fits in uint64_t
+
+//global variables
+static const uint64_t fl_pow10[FL_DIG_MAX + 1] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+	10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+	1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull};
+
+//digit run at p: *v = its value, return the end of the run. at most FL_DIG_MAX digits are taken
+//end is the end of the readable buffer, not of the line: a run always stops at the line terminator
+static const char *fl_digits_scalar(const char *p, const char *end, uint64_t *v) {
+	const char *q = p;
+	uint64_t x = 0;
+
+	while (q < end && q - p < FL_DIG_MAX && (unsigned) (*q - '0') <= 9) x = x * 10 + (*q++ - '0');
+	*v = x;
+	return q;
+}
+
+#if defined(FL_X86)
+static __m128i fl_shuf[17];				//right-align n digits, zero-fill on the left
+
+//digit run at p, 16 bytes at a time
+//the run is found with a compare / movemask, right-aligned with pshufb and folded
+//10x / 100x / 10000x with three multiply-adds: two 8-digit halves
+__attribute__((target("ssse3")))
+static const char *fl_digits_ssse3(const char *p, const char *end, uint64_t *v) {
+	__m128i x, d;
+	uint32_t m, n;
+	uint64_t hi;
+
+	if (end - p < 16) return fl_digits_scalar(p, end, v);	//don't read past the buffer
+	x = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) p), _mm_set1_epi8('0'));
+	d = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(9)), x);	//digits: 0..9 after the subtraction
+	m = ~_mm_movemask_epi8(d) & 0xffff;
+	n = m ? __builtin_ctz(m) : 16;		//length of the run
+	if (n == 16) return fl_digits_scalar(p, end, v);	//longer than a vector: rare
+	x = _mm_shuffle_epi8(x, fl_shuf[n]);
+	x = _mm_maddubs_epi16(x, _mm_set1_epi16(0x010a));		//pairs of digits
+	x = _mm_madd_epi16(x, _mm_set1_epi32(0x00010064));		//groups of 4
+	x = _mm_packs_epi32(x, x);
+	x = _mm_madd_epi16(x, _mm_set1_epi32(0x00012710));		//groups of 8
+	hi = (uint32_t) _mm_cvtsi128_si32(x);
+	*v = hi * 100000000ull + (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(x, 4));
+	return p + n;
+}
+#endif
+
+static const char *(*fl_digits)(const char *p, const char *end, uint64_t *v) = fl_digits_scalar;
+
+//select the digit parser
+int fl_simd(int on) {
+#if defined(FL_X86)
+	int i, n;
+
+	for (n = 0; n <= 16; n++)
+		for (i = 0; i < 16; i++) ((uint8_t *) &fl_shuf[n])[i] = (i < 16 - n) ? 0x80 : i - (16 - n);
+	__builtin_cpu_init();
+	if (on && __builtin_cpu_supports("ssse3")) {fl_digits = fl_digits_ssse3; return 1;}
+#endif
+	fl_digits = fl_digits_scalar;
+	return 0;
+}
+
+//days since the epoch of a civil date - proleptic gregorian, no timegm() / time zone lookups
+static int64_t fl_days(int64_t y, uint32_t m, uint32_t d) {
+	int64_t era;
+	uint32_t yoe, doy, doe;
+
+	y -= m <= 2;
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+//optional fraction ".fff" at p: *ns = its value, scaled to 10^-9. return the end
+static const char *fl_frac(const char *p, const char *end, const char *lim, int64_t *ns) {
+	const char *q;
+	uint64_t v;
+
+	*ns = 0;
+	if (p >= end || *p != '.') return p;
+	q = fl_digits(p + 1, lim, &v);
+	if (q - (p + 1) <= 9) *ns = v * fl_pow10[9 - (q - (p + 1))];
+	else *ns = v / fl_pow10[(q - (p + 1)) - 9];
+	return q;
+}
+
+//timestamp in [p, end), the part of the line before the tag. FL_NOTS if there is none
+//lim: end of the readable buffer. *e: end of the timestamp, if e != NULL
+static int64_t fl_ts(const char *p, const char *end, const char *lim, const char **e) {
+	const char *q;
+	uint64_t y, mo, d, h, mi, s;
+	int64_t ns;
+
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '[' || *p == '\r')) p++;	//"\n\r" line ends leave a '\r' in front
+	q = fl_digits(p, lim, &y);
+	if (q == p) return FL_NOTS;
+	if (q - p == 4 && q < end && *q == '-') {	//yyyy-mm-dd[ T]hh:mm:ss[.fff]
+		p = fl_digits(q + 1, lim, &mo);
+		if (p >= end || *p != '-') return FL_NOTS;
+		q = fl_digits(p + 1, lim, &d);
+		if (q >= end || (*q != ' ' && *q != 'T')) return FL_NOTS;
+		p = fl_digits(q + 1, lim, &h);
+		if (p >= end || *p != ':') return FL_NOTS;
+		q = fl_digits(p + 1, lim, &mi);
+		if (q >= end || *q != ':') return FL_NOTS;
+		p = fl_digits(q + 1, lim, &s);
+		if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60) return FL_NOTS;
+		p = fl_frac(p, end, lim, &ns);
+		if (e) *e = p;
+		return ((fl_days(y, mo, d) * 24 + h) * 60 + mi) * 60000000000ll + s * 1000000000ll + ns;
+	}
+	q = fl_frac(q, end, lim, &ns);		//seconds since the epoch
+	if (q < end && *q != ' ' && *q != '\t' && *q != ']') return FL_NOTS;	//e.g. a bare time of day
+	if (e) *e = q;
+	return (int64_t) y * 1000000000ll + ns;
+}
+
+//one line: ls = line start, f = tag, le = line end, lim = end of the readable buffer
+static int fl_line(const char *ls, const char *f, const char *le, const char *lim, fl_rec_t *r) {
+	const char *p = f + FL_TAG_LEN, *q;
+	uint64_t v, fr = 0;
+
+	while (p < le && *p == ' ') p++;
+	q = fl_digits(p, lim, &v);
+	if (q == p || v > UINT32_MAX) return 0;
+	if (q < le && *q == '.') {			//fractional part, scaled to 3 digits
+		p = q + 1;
+		q = fl_digits(p, lim, &fr);
+		if (q - p <= 3) fr *= fl_pow10[3 - (q - p)];
+		else fr /= fl_pow10[(q - p) - 3];
+	}
+	if (le - q < 2 || q[0] != 'H' || q[1] != 'z') return 0;
+	r->freq = v;
+	r->frac = fr;
+	if ((p = memmem(q, le - q, FL_UTC, FL_UTC_LEN)) != NULL) {	//the calibrator's own utc: wins over the logger's
+		p += FL_UTC_LEN;
+		while (p < le && *p == ' ') p++;
+		if ((q = fl_digits(p, lim, &v)) > p) {r->ts = (int64_t) v * 1000000000ll; return 1;}
+	}
+	r->ts = (f > ls) ? fl_ts(ls, f, lim, NULL) : FL_NOTS;
+	return 1;
+}
+
+//leading timestamp
+int64_t fl_parse_ts(const char *p, const char *end, const char **rest) {
+	const char *q;
+	int64_t ts = fl_ts(p, end, end, &q);
+
+	if (ts == FL_NOTS) {*rest = p; return ts;}
+	while (q < end && (*q == ' ' || *q == '\t' || *q == ']')) q++;
+	*rest = q;
+	return ts;
+}
+
+//parse one line
+int fl_parse_line(const char *p, const char *end, fl_rec_t *r) {
+	const char *f = memmem(p, end - p, FL_TAG, FL_TAG_LEN);
+
+	return f ? fl_line(p, f, end, end, r) : 0;
+}
+
+//1 if the line [ls, f) is aggd's "[ts] device " for device dev, n = strlen(dev)
+static int fl_dev(const char *ls, const char *f, const char *dev, size_t n) {
+	const char *q;
+
+	if (fl_parse_ts(ls, f, &q) == FL_NOTS) return 0;
+	return (size_t) (f - q) > n && memcmp(q, dev, n) == 0 && q[n] == ' ';
+}
+
+//parse a buffer of whole lines, all of them or those of device dev
+static long fl_scan(const char *p, const char *end, const char *dev, fl_buf_t *b) {
+	const char *f, *ls, *le;
+	size_t n0 = b->n, n = dev ? strlen(dev) : 0;
+	fl_rec_t *r;
+
+	while (p < end && (f = memmem(p, end - p, FL_TAG, FL_TAG_LEN)) != NULL) {
+		ls = memrchr(p, '\n', f - p);	//start of the line the tag is on
+		ls = ls ? ls + 1 : p;
+		le = memchr(f, '\n', end - f);	//and its end
+		if (le == NULL) le = end;
+		if (dev && fl_dev(ls, f, dev, n) == 0) {p = le + 1; continue;}	//another device's
+		if (b->n == b->cap) {			//grow the array
+			r = realloc(b->r, (b->cap ? b->cap * 2 : 4096) * sizeof(fl_rec_t));
+			if (r == NULL) return -1;
+			b->r = r; b->cap = b->cap ? b->cap * 2 : 4096;
+		}
+		b->n += fl_line(ls, f, le, end, &b->r[b->n]);
+		p = le + 1;						//the first tag on a line only
+	}
+	return b->n - n0;
+}
+
+//parse a buffer of whole lines
+long fl_parse(const char *p, const char *end, fl_buf_t *b) {
+	return fl_scan(p, end, NULL, b);
+}
+
+//parse a buffer of whole lines of aggd output, device dev only
+long fl_parse_dev(const char *p, const char *end, const char *dev, fl_buf_t *b) {
+	return fl_scan(p, end, dev, b);
+}
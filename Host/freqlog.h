@@ -0,0 +1,58 @@
+#ifndef FREQLOG_H_INCLUDED
+#define FREQLOG_H_INCLUDED
+
+#include <stdint.h>						//we use int64_t
+#include <stddef.h>						//we use size_t
+
+//log format, as sent by the calibrators over the uart, one reading per line:
+//  freq = 40000123Hz.
+//  freq =   40000123.456Hz.
+//  freq =   40000123Hz, freq =   40000123.456Hz, +/-    3ppb.
+//the first "freq = N[.fff]Hz" on a line is the reading; lines without one (temp, overflow,
+//waiting for PPS, isr statistics) are skipped.
+//an optional timestamp may precede it, as added by most terminal loggers:
+//  2026-10-18 12:34:56.789 freq = ...		date and time, utc, 'T' or ' ' separated
+//  [1760790896.789] freq = ...				seconds since the epoch, brackets optional
+//a calibrator with the gps' nmea tags the reading with the utc second of the 1pps it ended on:
+//  freq =   40000123.456Hz, utc = 1760790896.		seconds since the epoch
+//that is the reading's timestamp, whatever precedes the line: readings from different
+//calibrators line up on it, not on when their lines reached the logger.
+
+//global defines
+#define FL_NOTS					INT64_MIN			//no timestamp on the line
+
+//one reading
+typedef struct {
+	int64_t ts;							//timestamp, ns since the epoch: the utc tag, else the leading one, else FL_NOTS
+	uint32_t freq;						//frequency, integer part, Hz
+	uint16_t frac;						//frequency, fractional part, 1/1000 Hz
+} fl_rec_t;
+
+//readings, in a growing array
+typedef struct {
+	fl_rec_t *r;						//readings
+	size_t n, cap;						//used / allocated
+} fl_buf_t;
+
+//global variables
+
+//select the digit parser: 1 -> simd if the cpu supports it, 0 -> scalar
+//return 1 if the simd parser is in use
+int fl_simd(int on);
+
+//parse one line [p, end), terminator excluded
+//return 1 and fill in *r if the line carries a reading, 0 otherwise
+int fl_parse_line(const char *p, const char *end, fl_rec_t *r);
+
+//leading timestamp of a line [p, end), in one of the forms above
+//return it, FL_NOTS if there is none, and *rest = the text after it and its separator (p if none)
+int64_t fl_parse_ts(const char *p, const char *end, const char **rest);
+
+//parse a buffer of whole lines [p, end), appending the readings to b
+//return the number of readings added, or -1 if out of memory
+long fl_parse(const char *p, const char *end, fl_buf_t *b);
+
+//same, for aggd output ("[ts] device line" lines, see aggd.c): the readings of device dev only
+long fl_parse_dev(const char *p, const char *end, const char *dev, fl_buf_t *b);
+
+#endif /* FREQLOG_H_INCLUDED */
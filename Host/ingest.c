@@ -0,0 +1,151 @@
+//ingest.c
+//Ingestion of calibrator logs into a columnar file
+//
+//Memory-maps the log files, cuts them into line-aligned chunks and parses the chunks
+//on all cores (see freqlog.h for the log format). The readings are written, in file
+//and line order, to one columnar file (see colstore.h): timestamp, freq, fractional part.
+//Throughput is reported on stderr.
+//aggd output interleaves many devices: -d picks one of them, one columnar file per device.
+//
+//Usage:
+//  ingest [-o out_file] [-d device] [-j threads] [-c chunk_mb] [-s] log_file...
+//
+//  -o output file, default freq.col
+//  -d the logs are aggd output ("[ts] device line"): the readings of this device only
+//  -j number of threads, default: one per online cpu
+//  -c chunk size, MB, default 16
+//  -s scalar digit parser only, for comparison
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use uint32_t
+#include <string.h>						//we use memchr
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include <fcntl.h>						//we use open
+#include <pthread.h>					//we use pthreads
+#include <sys/mman.h>					//we use mmap
+#include <sys/stat.h>					//we use fstat
+#include "freqlog.h"					//we use log parser
+#include "colstore.h"					//we use columnar store
+
+//global defines
+#define OUT_FILE	"freq.col"			//default output file
+#define CHUNK_MB	16					//default chunk size, MB
+#define THREAD_MAX	256					//max. number of threads
+
+//one chunk of a mapped log file
+typedef struct {
+	const char *p, *end;				//whole lines
+	fl_buf_t b;							//readings parsed from it
+} task_t;
+
+//global variables
+static task_t *task;					//all chunks of all files, in order
+static size_t ntask;
+static size_t next_task = 0;			//next chunk to be parsed, shared by the threads
+static int err = 0;						//1->a thread ran out of memory
+static const char *dev = NULL;			//aggd device to keep, NULL->plain logs, every reading
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//first line start at or after pos
+static size_t line_edge(const char *p, size_t len, size_t pos) {
+	const char *q;
+
+	if (pos == 0 || pos >= len) return (pos < len) ? pos : len;
+	q = memchr(p + pos - 1, '\n', len - pos + 1);
+	return q ? (size_t) (q - p) + 1 : len;
+}
+
+//worker: parse chunks until none is left
+static void *worker(void *arg) {
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED)) < ntask)
+		if ((dev ? fl_parse_dev(task[i].p, task[i].end, dev, &task[i].b) : fl_parse(task[i].p, task[i].end, &task[i].b)) < 0) err = 1;
+	return NULL;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: ingest [-o out_file] [-d device] [-j threads] [-c chunk_mb] [-s] log_file...\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	const char *out = OUT_FILE;
+	size_t chunk = CHUNK_MB << 20, bytes = 0, len, pos, edge, i, n;
+	long nthread = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t tid[THREAD_MAX];
+	int opt, simd = 1, fd, f;
+	struct stat st;
+	const char *p;
+	int64_t t0, t1, t2;
+	cs_t cs;
+
+	while ((opt = getopt(argc, argv, "o:d:j:c:sh")) != -1) {
+		switch (opt) {
+			case 'o': out = optarg; break;
+			case 'd': dev = optarg; break;
+			case 'j': nthread = strtol(optarg, NULL, 0); break;
+			case 'c': chunk = strtoul(optarg, NULL, 0) << 20; break;
+			case 's': simd = 0; break;
+			default: usage();
+		}
+	}
+	if (optind == argc || nthread < 1 || chunk == 0) usage();
+	if (nthread > THREAD_MAX) nthread = THREAD_MAX;
+	simd = fl_simd(simd);
+
+	//map the files and cut them into chunks
+	t0 = now_ns();
+	for (f = optind; f < argc; f++) {
+		if ((fd = open(argv[f], O_RDONLY)) < 0 || fstat(fd, &st)) {perror(argv[f]); return 1;}
+		len = st.st_size;
+		if (len == 0) {close(fd); continue;}
+		p = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED) {perror(argv[f]); return 1;}
+		madvise((void *) p, len, MADV_SEQUENTIAL);
+		task = realloc(task, (ntask + len / chunk + 1) * sizeof(task_t));
+		for (pos = 0; pos < len; pos = edge) {
+			edge = line_edge(p, len, pos + chunk);
+			task[ntask].p = p + pos; task[ntask].end = p + edge;
+			memset(&task[ntask].b, 0, sizeof(fl_buf_t));
+			ntask += 1;
+		}
+		bytes += len;
+	}
+
+	//parse
+	t1 = now_ns();
+	for (i = 0; i < (size_t) nthread; i++) pthread_create(&tid[i], NULL, worker, NULL);
+	for (i = 0; i < (size_t) nthread; i++) pthread_join(tid[i], NULL);
+	t2 = now_ns();
+	if (err) {fprintf(stderr, "ingest: out of memory\n"); return 1;}
+
+	//gather the columns, in order
+	for (n = 0, i = 0; i < ntask; i++) n += task[i].b.n;
+	if (cs_alloc(&cs, n)) {fprintf(stderr, "ingest: out of memory\n"); return 1;}
+	for (n = 0, i = 0; i < ntask; i++) {
+		for (pos = 0; pos < task[i].b.n; pos++, n++) {
+			cs.ts[n] = task[i].b.r[pos].ts;
+			cs.freq[n] = task[i].b.r[pos].freq;
+			cs.frac[n] = task[i].b.r[pos].frac;
+		}
+		free(task[i].b.r);
+	}
+	if (cs_write(out, &cs)) {perror(out); return 1;}
+	fprintf(stderr, "ingest: %d file(s), %zu bytes, %zu readings, %ld thread(s), %s parser: map %.3fs, parse %.3fs = %.0f MB/s, total %.3fs\n",
+		argc - optind, bytes, cs.n, nthread, simd ? "ssse3" : "scalar",
+		(t1 - t0) * 1e-9, (t2 - t1) * 1e-9, bytes / ((t2 - t1) * 1e-3), (now_ns() - t0) * 1e-9);
+	cs_free(&cs);
+	return 0;
+}
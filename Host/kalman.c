@@ -0,0 +1,145 @@
+//source file for the fixed-point kalman filter
+//tracks phase, frequency offset and drift of the timebase from the 1pps captures
+//
+//model, one step per gate:
+//  phase' = phase + freq + drift / 2
+//  freq'  = freq + drift
+//  drift' = drift
+//measurement: phase, accumulated from the measured intervals
+//everything in Q31.32 - the phase is re-centered after each update to stay in range
+
+#include "kalman.h"						//we use kalman filter
+
+//global defines
+#define KF_INT				((int64_t) 0xffffffff00000000ull)	//integer part of a Q31.32 number
+
+//global variables
+
+//multiply two Q31.32 numbers
+//64x64 bit product built from 32x32 bit partial products - no 128-bit type needed
+static int64_t kf_mul(int64_t a, int64_t b) {
+	uint64_t ua, ub, al, ah, bl, bh, r;
+	uint8_t neg = 0;
+
+	if (a < 0) {ua = -a; neg ^= 1;} else ua = a;
+	if (b < 0) {ub = -b; neg ^= 1;} else ub = b;
+	al = (uint32_t) ua; ah = ua >> 32;
+	bl = (uint32_t) ub; bh = ub >> 32;
+	r  = ((ah * bh) << 32) + ah * bl + al * bh + ((al * bl) >> 32);
+	return neg ? -(int64_t) r : (int64_t) r;
+}
+
+//integer square root
+static uint32_t kf_sqrt(uint64_t v) {
+	uint64_t r = 0, b = 1ull << 62;
+
+	while (b > v) b >>= 2;
+	while (b) {
+		if (v >= r + b) {v -= r + b; r = (r >> 1) + b;}
+		else r >>= 1;
+		b >>= 2;
+	}
+	return r;
+}
+
+//time update, one gate
+//p = f * p * f' + q, f = [1 1 1/2; 0 1 1; 0 0 1] - additions and shifts only
+static void kf_predict(kf_t *kf) {
+	int64_t *x = kf->x, *p = kf->p;
+	int64_t r00, r01, r02, r11, r12;
+
+	x[0] += x[1] + (x[2] >> 1);
+	x[1] += x[2];
+
+	r00  = p[0] + p[1] + (p[2] >> 1);	//r = f * p
+	r01  = p[1] + p[3] + (p[4] >> 1);
+	r02  = p[2] + p[4] + (p[5] >> 1);
+	r11  = p[3] + p[4];
+	r12  = p[4] + p[5];
+	p[0] = r00 + r01 + (r02 >> 1) + kf->q[0];	//p = r * f' + q
+	p[1] = r01 + r02;
+	p[2] = r02;
+	p[3] = r11 + r12 + kf->q[1];
+	p[4] = r12;
+	p[5]+= kf->q[2];
+}
+
+//reset the filter
+void kf_init(kf_t *kf, int32_t n) {
+	kf->n = n;							//nominal interval
+	kf->x[0] = kf->x[1] = kf->x[2] = 0;	//no offset from nominal
+	kf->z = 0;
+	kf->q[0] = KF_Q0; kf->q[1] = KF_Q1; kf->q[2] = KF_Q2;
+	kf->r = KF_R;
+	kf->p[0] = kf->r;					//phase: one capture
+	kf->p[3] = kf->r * 2;				//frequency: difference of two captures
+	kf->p[5] = KF_P2;
+	kf->p[1] = kf->p[2] = kf->p[4] = 0;
+}
+
+//reset the filter from a stored estimate
+void kf_seed(kf_t *kf, int32_t n, uint32_t frac, int64_t drift) {
+	kf_init(kf, n);
+	kf->x[1] = frac;					//frequency offset from n: the fractional part
+	kf->x[2] = drift;
+	kf->p[3] = KF_P1;					//trusted to a few ticks: the temperature may have changed since
+}
+
+//process one measured interval
+int kf_update(kf_t *kf, int32_t ticks) {
+	return kf_update_c(kf, ticks, 0);
+}
+
+//process one measured interval, corrected
+//the correction goes into the accumulated phase: it is carried, like the interval, over a glitch
+int kf_update_c(kf_t *kf, int32_t ticks, int64_t c) {
+	int64_t *x = kf->x, *p = kf->p;
+	int64_t s, inv, k0, k1, k2, y;
+	uint32_t frac;
+	int32_t m = 1;
+
+	//number of gates covered by this interval: 0 for a glitch, >1 for missed 1pps pulses
+	if (ticks - kf->n > kf->n / 2 || kf->n - ticks > kf->n / 2) {
+		m = (ticks + kf->n / 2) / kf->n;
+		if (m > KF_MISS || m < 0) {kf_init(kf, kf_freq(kf, &frac)); return -1;}	//lost track: restart from the current estimate
+	}
+	kf->z += (int64_t) (ticks - m * kf->n) * KF_Q32(1) + c;	//accumulate the phase
+	if (m == 0) return 0;				//glitch: the phase is carried to the next interval
+	while (m--) kf_predict(kf);
+
+	//measurement update, h = [1 0 0]
+	s = p[0] + kf->r;					//innovation variance
+	inv = (s > 1) ? (int64_t) (0xffffffffffffffffull / (uint64_t) s) : INT64_MAX;	//1/s
+	k0 = kf_mul(p[0], inv);				//gain
+	k1 = kf_mul(p[1], inv);
+	k2 = kf_mul(p[2], inv);
+	y = kf->z - x[0];					//innovation
+	x[0] += kf_mul(k0, y);
+	x[1] += kf_mul(k1, y);
+	x[2] += kf_mul(k2, y);
+	p[5] -= kf_mul(k2, p[2]);			//p = (i - k * h) * p
+	p[4] -= kf_mul(k1, p[2]);
+	p[3] -= kf_mul(k1, p[1]);
+	p[2] -= kf_mul(k0, p[2]);
+	p[1] -= kf_mul(k0, p[1]);
+	p[0] -= kf_mul(k0, p[0]);
+	if (p[0] < 1) p[0] = 1;				//keep the diagonal positive despite rounding
+	if (p[3] < 1) p[3] = 1;
+	if (p[5] < 1) p[5] = 1;
+
+	//re-center the phase: move its integer part out of both the state and the measurement
+	s = x[0] & KF_INT;
+	x[0] -= s; kf->z -= s;
+	return 0;
+}
+
+//filtered interval
+int32_t kf_freq(kf_t *kf, uint32_t *frac) {
+	*frac = (uint32_t) kf->x[1];		//fractional part, always positive
+	return kf->n + (int32_t) (kf->x[1] >> 32);	//integer part, rounded down
+}
+
+//1-sigma uncertainty of the filtered interval
+uint32_t kf_sigma(kf_t *kf) {
+	return kf_sqrt(kf->p[3]);			//sqrt of a Q31.32 number is Q16.16
+}
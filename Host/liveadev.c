@@ -0,0 +1,117 @@
+//liveadev.c
+//Live allan deviation of every device published in aggd's shared-memory ring (see shmring.h)
+//
+//Each reading updates its device's incremental overlapping adev at the octave taus (see
+//stab.h) in O(1) amortized - nothing is recomputed, however long the run. Every period the
+//current curves are printed as csv: time, device, tau, terms, adev. Dozens of devices at
+//1 reading per second cost next to nothing.
+//The readings are taken as consecutive, tau0 apart: a reading lost to a ring overrun is a
+//gap the curves don't see (reported on stderr).
+//
+//Usage:
+//  liveadev [-t tau0_s] [-f nominal_hz] [-p period_s] [-d device] shm_name
+//
+//  -t sampling interval, default 1s
+//  -f nominal frequency, default: each device's first reading
+//  -p print period, default 10s
+//  -d only this device
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use calloc
+#include <stdint.h>						//we use uint64_t
+#include <string.h>						//we use strcmp
+#include <time.h>						//we use nanosleep
+#include <unistd.h>						//we use getopt
+#include <signal.h>						//we use signal
+#include "shmring.h"					//we use shared-memory ring
+#include "stab.h"						//we use stability statistics
+
+//global defines
+#define POLL_MS		10					//polling period when the ring is empty
+
+//per device state
+typedef struct {
+	double f0;							//nominal frequency, mHz
+	stab_inc_t s;						//its adev
+} live_t;
+
+//global variables
+static live_t *dev[SHR_DEV_MAX];		//allocated on the first reading
+static volatile sig_atomic_t quit = 0;	//1->terminate
+
+static void on_signal(int sig) {quit = 1;}
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//print the curves
+static void report(const shr_t *r, const char *only) {
+	int64_t t = now_ns();
+	double d;
+	uint64_t n;
+	int i, k;
+
+	for (i = 0; i < SHR_DEV_MAX; i++) {
+		if (dev[i] == NULL || (only && strcmp(only, shr_name(r, i)))) continue;
+		for (k = 0; k < STAB_OCT && (n = stab_inc_dev(&dev[i]->s, k, &d)); k++)
+			printf("%lld.%03lld,%s,%g,%llu,%.4e\n", (long long) (t / 1000000000), (long long) (t / 1000000 % 1000), shr_name(r, i),
+				dev[i]->s.tau0 * (double) (1ull << k), (unsigned long long) n, d);
+	}
+	fflush(stdout);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: liveadev [-t tau0_s] [-f nominal_hz] [-p period_s] [-d device] shm_name\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	struct timespec poll = {0, POLL_MS * 1000000l};
+	double tau0 = 1, f0 = 0, period = 10, f;
+	const char *only = NULL;
+	int64_t next;
+	uint64_t lost = 0;
+	shr_rec_t rec;
+	shr_t r;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:f:p:d:h")) != -1) {
+		switch (opt) {
+			case 't': tau0 = atof(optarg); break;
+			case 'f': f0 = atof(optarg) * 1000; break;
+			case 'p': period = atof(optarg); break;
+			case 'd': only = optarg; break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 1 || tau0 <= 0 || period <= 0) usage();
+	if (shr_open(&r, argv[optind])) {perror(argv[optind]); return 1;}
+	signal(SIGINT, on_signal); signal(SIGTERM, on_signal);
+	printf("time_s,device,tau_s,terms,adev\n");
+
+	next = now_ns() + period * 1e9;
+	while (!quit) {
+		while (shr_get(&r, &rec)) {
+			if (rec.dev >= SHR_DEV_MAX) continue;
+			f = rec.freq * 1000.0 + rec.frac;
+			if (dev[rec.dev] == NULL) {	//first reading of a device
+				if ((dev[rec.dev] = malloc(sizeof(live_t))) == NULL) {perror("liveadev"); return 1;}
+				dev[rec.dev]->f0 = (f0 > 0) ? f0 : f;
+				stab_inc_init(&dev[rec.dev]->s, tau0);
+			}
+			stab_inc_add(&dev[rec.dev]->s, (f - dev[rec.dev]->f0) / dev[rec.dev]->f0);
+		}
+		if (r.lost != lost) {fprintf(stderr, "liveadev: %llu readings lost\n", (unsigned long long) (r.lost - lost)); lost = r.lost;}
+		if (now_ns() >= next) {report(&r, only); next += period * 1e9;}
+		nanosleep(&poll, NULL);
+	}
+	report(&r, only);
+	shr_close(&r, argv[optind], 0);
+	return 0;
+}
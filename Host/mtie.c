@@ -0,0 +1,123 @@
+//mtie.c
+//Time interval error and MTIE of the readings in a columnar file
+//
+//The readings are taken as consecutive, tau0 apart, and integrated into the time interval
+//error against the nominal frequency: TIE[i] = sum of (f - f0) / f0 * tau0 over the readings
+//before i. MTIE(tau) is the largest peak-to-peak TIE in any window of tau; every window size
+//is one O(n) pass with monotonic min / max deques (see stab.h), shared out to all cores.
+//Output is csv: tau, window points, mtie. With -x, the TIE itself instead.
+//Timing is reported on stderr.
+//
+//Usage:
+//  mtie [-j threads] [-f nominal_hz] [-t tau0_s] [-d] [-x] col_file
+//
+//  -j number of threads, default: one per online cpu
+//  -f nominal frequency, default: the mean of the readings - the offset is then not in the TIE
+//  -t sampling interval, default: from the timestamps, 1s if there are none
+//  -d taus 1, 2, 5, 10, ... x tau0, default 1, 2, 4, 8, ... x tau0
+//  -x print the TIE, csv: time (s from the first reading), tie (s)
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use int64_t
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include <pthread.h>					//we use pthreads
+#include "colstore.h"					//we use columnar store
+#include "stab.h"						//we use stability statistics
+
+//global defines
+#define THREAD_MAX	256					//max. number of threads
+#define TAU_MAX		256					//max. taus
+
+//one window size
+typedef struct {
+	size_t w;							//points - 1
+	double mtie;						//-1 -> not computed
+} task_t;
+
+//global variables
+static double *x;						//tie, s
+static size_t nx;
+static task_t task[TAU_MAX];
+static size_t ntask;
+static size_t next_task = 0;			//next window size to be computed, shared by the threads
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//worker: compute window sizes until none is left
+static void *worker(void *arg) {
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED)) < ntask)
+		task[i].mtie = stab_mtie(x, nx, task[i].w);
+	return NULL;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: mtie [-j threads] [-f nominal_hz] [-t tau0_s] [-d] [-x] col_file\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	long nthread = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t tid[THREAD_MAX];
+	double f0 = 0, tau0 = 0;
+	int opt, decade = 0, tie = 0;
+	size_t i, w, step;
+	int64_t t0, t1, t2;
+	cs_t cs;
+
+	while ((opt = getopt(argc, argv, "j:f:t:dxh")) != -1) {
+		switch (opt) {
+			case 'j': nthread = strtol(optarg, NULL, 0); break;
+			case 'f': f0 = atof(optarg) * 1000; break;
+			case 't': tau0 = atof(optarg); break;
+			case 'd': decade = 1; break;
+			case 'x': tie = 1; break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 1 || nthread < 1) usage();
+	if (nthread > THREAD_MAX) nthread = THREAD_MAX;
+
+	//readings -> tie
+	t0 = now_ns();
+	if (cs_read(argv[optind], &cs)) {perror(argv[optind]); return 1;}
+	if (cs.n < 2) {fprintf(stderr, "mtie: too few readings\n"); return 1;}
+	nx = cs.n + 1;
+	if ((x = stab_load(&cs, 1, &tau0, &f0)) == NULL) {fprintf(stderr, "mtie: out of memory\n"); return 1;}
+	cs_free(&cs);
+	if (tie) {
+		printf("t_s,tie_s\n");
+		for (i = 0; i < nx; i++) printf("%g,%.6e\n", i * tau0, x[i]);
+		free(x);
+		return 0;
+	}
+
+	//the window sizes
+	for (w = 1, step = 0; w < nx && ntask < TAU_MAX; step++) {
+		task[ntask].w = w; task[ntask].mtie = -1;
+		ntask += 1;
+		w = decade ? ((step % 3 == 1) ? w / 2 * 5 : w * 2) : w * 2;	//1, 2, 5, 10, 20, 50, ...
+	}
+	t1 = now_ns();
+	for (i = 0; i < (size_t) nthread; i++) pthread_create(&tid[i], NULL, worker, NULL);
+	for (i = 0; i < (size_t) nthread; i++) pthread_join(tid[i], NULL);
+	t2 = now_ns();
+
+	printf("tau_s,points,mtie_s\n");
+	for (i = 0; i < ntask; i++)
+		if (task[i].mtie >= 0) printf("%g,%zu,%.4e\n", task[i].w * tau0, task[i].w + 1, task[i].mtie);
+	fprintf(stderr, "mtie: %zu readings, tau0 %gs, f0 %.3fHz, %zu window sizes, %ld thread(s): load %.3fs, compute %.3fs\n",
+		nx - 1, tau0, f0 / 1000, ntask, nthread, (t1 - t0) * 1e-9, (t2 - t1) * 1e-9);
+	free(x);
+	return 0;
+}
@@ -0,0 +1,162 @@
+//psd.c
+//Power spectral density of the readings in a columnar file, Welch's method
+//
+//The readings are taken as consecutive, tau0 apart, and turned into fractional frequency
+//y against the nominal. y is cut into segments of -l points overlapping by half, each
+//segment has its mean removed and a hann window applied, and the periodograms are averaged.
+//Two segments go through one complex fft (one as the real part, one as the imaginary part)
+//and are split apart afterwards, so a real segment costs half an fft. The segments are
+//shared out to all cores, each thread summing into its own spectrum.
+//Output is csv, one-sided:
+//  f (Hz), S_y(f) (1/Hz), S_x(f) (s^2/Hz), S_phi(f) (rad^2/Hz, at the nominal), L(f) (dBc/Hz)
+//with S_x = S_y / (2 pi f)^2, S_phi = (2 pi f0)^2 S_x, L = S_phi / 2.
+//Timing and throughput are reported on stderr.
+//
+//Usage:
+//  psd [-j threads] [-f nominal_hz] [-t tau0_s] [-l segment] col_file
+//
+//  -j number of threads, default: one per online cpu
+//  -f nominal frequency, default: the mean of the readings
+//  -t sampling interval, default: from the timestamps, 1s if there are none
+//  -l segment length, a power of 2, default 4096: resolution 1 / (l * tau0)
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use int64_t
+#include <math.h>						//we use cos
+#include <time.h>						//we use clock_gettime
+#include <unistd.h>						//we use getopt
+#include <pthread.h>					//we use pthreads
+#include "colstore.h"					//we use columnar store
+#include "fft.h"						//we use fft
+#include "stab.h"						//we use stab_load
+
+//global defines
+#define THREAD_MAX	256					//max. number of threads
+#define SEG_LEN		4096				//default segment length
+#define GRAB		8					//segment pairs taken by a thread at a time
+
+//per thread state
+typedef struct {
+	pthread_t tid;
+	fft_c_t *buf;						//segment pair being transformed
+	double *sum;						//sum of the periodograms, l / 2 + 1 bins
+} thr_t;
+
+//global variables
+static double *y;						//fractional frequency
+static size_t ny;
+static size_t seg = SEG_LEN;
+static double *win;						//hann window
+static fft_t plan;
+static size_t nseg, npair;				//segments / pairs of them
+static size_t next_pair = 0;			//next pair to be transformed, shared by the threads
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//segment k into the real (part = 0) or imaginary (part = 1) part of buf: mean removed, windowed
+static void load(fft_c_t *buf, size_t k, int part) {
+	const double *p = y + k * (seg / 2);
+	double mean = 0;
+	size_t j;
+
+	for (j = 0; j < seg; j++) mean += p[j];
+	mean /= seg;
+	if (part) for (j = 0; j < seg; j++) buf[j].im = (p[j] - mean) * win[j];
+	else for (j = 0; j < seg; j++) buf[j].re = (p[j] - mean) * win[j];
+}
+
+//worker: transform pairs of segments until none is left
+static void *worker(void *arg) {
+	thr_t *t = arg;
+	const fft_c_t *X = t->buf;
+	size_t p, p1, j, k, kk;
+	double ar, ai, br, bi;
+
+	while ((p = __atomic_fetch_add(&next_pair, GRAB, __ATOMIC_RELAXED)) < npair) {
+		for (p1 = (p + GRAB < npair) ? p + GRAB : npair; p < p1; p++) {
+			load(t->buf, 2 * p, 0);
+			if (2 * p + 1 < nseg) load(t->buf, 2 * p + 1, 1);
+			else for (j = 0; j < seg; j++) t->buf[j].im = 0;	//odd one out
+			fft_run(&plan, t->buf);
+			for (k = 0; k <= seg / 2; k++) {	//X = A + iB, A and B real: A[k] = (X[k] + X*[-k]) / 2, B[k] = (X[k] - X*[-k]) / 2i
+				kk = (seg - k) & (seg - 1);
+				ar = X[k].re + X[kk].re; ai = X[k].im - X[kk].im;
+				br = X[k].im + X[kk].im; bi = X[kk].re - X[k].re;
+				t->sum[k] += (ar * ar + ai * ai + br * br + bi * bi) / 4;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: psd [-j threads] [-f nominal_hz] [-t tau0_s] [-l segment] col_file\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	long nthread = sysconf(_SC_NPROCESSORS_ONLN);
+	static thr_t thr[THREAD_MAX];
+	double f0 = 0, tau0 = 0, u = 0, s, f, sy, sx;
+	int64_t t0, t1, t2;
+	size_t i, k;
+	int opt;
+	cs_t cs;
+
+	while ((opt = getopt(argc, argv, "j:f:t:l:h")) != -1) {
+		switch (opt) {
+			case 'j': nthread = strtol(optarg, NULL, 0); break;
+			case 'f': f0 = atof(optarg) * 1000; break;
+			case 't': tau0 = atof(optarg); break;
+			case 'l': seg = strtoul(optarg, NULL, 0); break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 1 || nthread < 1 || seg < 4 || (seg & (seg - 1))) usage();
+	if (nthread > THREAD_MAX) nthread = THREAD_MAX;
+
+	//readings -> fractional frequency
+	t0 = now_ns();
+	if (cs_read(argv[optind], &cs)) {perror(argv[optind]); return 1;}
+	if (cs.n < seg) {fprintf(stderr, "psd: fewer readings than a segment\n"); return 1;}
+	ny = cs.n;
+	if ((y = stab_load(&cs, 0, &tau0, &f0)) == NULL) {fprintf(stderr, "psd: out of memory\n"); return 1;}
+	cs_free(&cs);
+
+	//window, plan, per thread buffers
+	if (fft_init(&plan, seg) || (win = malloc(seg * sizeof(double))) == NULL) {fprintf(stderr, "psd: out of memory\n"); return 1;}
+	for (i = 0; i < seg; i++) {win[i] = 0.5 - 0.5 * cos(2 * M_PI * i / seg); u += win[i] * win[i];}
+	nseg = (ny - seg) / (seg / 2) + 1;
+	npair = (nseg + 1) / 2;
+	for (i = 0; i < (size_t) nthread; i++) {
+		thr[i].buf = malloc(seg * sizeof(fft_c_t));
+		thr[i].sum = calloc(seg / 2 + 1, sizeof(double));
+		if (thr[i].buf == NULL || thr[i].sum == NULL) {fprintf(stderr, "psd: out of memory\n"); return 1;}
+	}
+	t1 = now_ns();
+	for (i = 0; i < (size_t) nthread; i++) pthread_create(&thr[i].tid, NULL, worker, &thr[i]);
+	for (i = 0; i < (size_t) nthread; i++) pthread_join(thr[i].tid, NULL);
+	for (i = 1; i < (size_t) nthread; i++) for (k = 0; k <= seg / 2; k++) thr[0].sum[k] += thr[i].sum[k];
+	t2 = now_ns();
+
+	//average, one-sided density: 2 |X|^2 tau0 / sum(w^2), dc excluded
+	printf("f_hz,sy_per_hz,sx_s2_per_hz,sphi_rad2_per_hz,l_dbc_per_hz\n");
+	for (k = 1; k <= seg / 2; k++) {
+		f = k / (seg * tau0);
+		s = thr[0].sum[k] / nseg * tau0 / u;
+		sy = (k == seg / 2) ? s : 2 * s;	//nyquist: not folded
+		sx = sy / (4 * M_PI * M_PI * f * f);
+		printf("%.6e,%.4e,%.4e,%.4e,%.2f\n", f, sy, sx, sx * 4 * M_PI * M_PI * f0 * f0 * 1e-6, 10 * log10(sx * 2 * M_PI * M_PI * f0 * f0 * 1e-6));
+	}
+	fprintf(stderr, "psd: %zu readings, tau0 %gs, f0 %.3fHz, %zu segments of %zu, %ld thread(s): load %.3fs, compute %.3fs = %.1f Msamples/s\n",
+		ny, tau0, f0 / 1000, nseg, seg, nthread, (t1 - t0) * 1e-9, (t2 - t1) * 1e-9, nseg * (double) seg / ((t2 - t1) * 1e-3));
+	return 0;
+}
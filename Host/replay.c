@@ -0,0 +1,316 @@
+//replay.c
+//Replay of recorded calibrator logs into pseudo-terminals, for testing the host tools
+//without hardware
+//
+//Each source is written to its own pty(s), whose names are printed on stdout, one per line:
+//  pty_path source
+//so that e.g. aggd can be started on them. A source is a log file (any format ingest reads,
+//see freqlog.h), a columnar file (see colstore.h), or - with -a - each device of an aggd
+//output file. Leading timestamps are stripped: the ptys see what the calibrators sent.
+//
+//The lines keep their recorded spacing in time, scaled by the speed factor, and all sources
+//are merged on one clock. Lines without a timestamp follow the previous one after -i seconds;
+//those a source starts with are anchored to the earliest timestamp of all sources (and kept
+//no later than the source's own first one), so untimestamped and timestamped logs mix.
+//At -x 0 the lines are written as fast as the readers take them: the ptys block when full.
+//
+//Usage:
+//  replay [-x speed] [-n copies] [-a] [-b] [-i interval_s] [-w wait_s] file...
+//
+//  -x speed factor, default 1 (real time); 0 -> as fast as possible
+//  -n ptys per source, default 1: a few logs become a load of many calibrators
+//  -a the files are aggd output: one source per device
+//  -b readings sent as binary frames (see aggd.c), other lines as they are
+//  -i interval for lines without a timestamp, default 1s
+//  -w time for the readers to open the ptys, before the replay starts, default 1s
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#define _GNU_SOURCE						//we use posix_openpt
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use int64_t
+#include <string.h>						//we use memchr
+#include <time.h>						//we use clock_nanosleep
+#include <unistd.h>						//we use getopt
+#include <fcntl.h>						//we use open
+#include <termios.h>					//we use cfmakeraw
+#include <sys/mman.h>					//we use mmap
+#include <sys/stat.h>					//we use fstat
+#include "freqlog.h"					//we use log parser
+#include "colstore.h"					//we use columnar store
+
+//global defines
+#define SRC_MAX		4096				//max. number of sources
+#define PTY_BUF		4096				//output buffer per pty, bytes
+#define EOL			"\n\r"				//line end, as sent by the firmware
+#define FR_SYNC0	0xa5				//binary frame, as read by aggd
+#define FR_SYNC1	0x5a
+#define FR_READING	1
+
+//one line to be written
+typedef struct {
+	int64_t ts;							//recorded time, ns
+	uint32_t seq;						//order in the input: ties keep it
+	uint32_t src;						//source
+	uint8_t rel;						//1->ts relative to the source's start, not yet anchored
+	const char *p;						//text, without timestamp and line end
+	uint32_t n;
+} ev_t;
+
+//one pty
+typedef struct {
+	int m, s;							//master / slave, the slave kept open for the readers to come and go
+	char buf[PTY_BUF];					//output not yet written
+	size_t n;
+} pty_t;
+
+//one source
+typedef struct {
+	char name[64];
+	int64_t last;						//its last timestamp: kept non-decreasing
+	int64_t first;						//its first recorded timestamp, INT64_MAX if none yet
+	uint8_t rel;						//1->no recorded timestamp yet: last is relative to its start
+	pty_t *pty;							//its copies
+} src_t;
+
+//global variables
+static ev_t *ev;						//all lines of all sources
+static size_t nev, cap;
+static src_t src[SRC_MAX];
+static int nsrc;
+static int copies = 1, binary = 0;
+static int64_t interval = 1000000000ll;	//for lines without a timestamp, ns
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//source by name, created if new. -1 if there are too many
+static int src_get(const char *name, size_t n) {
+	static int last = -1;				//lines of a source usually come in runs
+	int i;
+
+	if (n > sizeof(src[0].name) - 1) n = sizeof(src[0].name) - 1;
+	if (last >= 0 && strncmp(src[last].name, name, n) == 0 && src[last].name[n] == 0) return last;
+	for (i = 0; i < nsrc; i++) if (strncmp(src[i].name, name, n) == 0 && src[i].name[n] == 0) return last = i;
+	if (nsrc == SRC_MAX) return -1;
+	memcpy(src[nsrc].name, name, n);
+	src[nsrc].last = INT64_MIN;
+	src[nsrc].first = INT64_MAX;
+	src[nsrc].rel = 0;
+	return last = nsrc++;
+}
+
+//add one line of source s. ts: FL_NOTS -> interval after the previous one, relative to the
+//source's start until it has a timestamp: anchored by ev_anchor()
+static int ev_add(int s, int64_t ts, const char *p, size_t n) {
+	uint8_t rel = 0;
+	ev_t *e;
+
+	if (nev == cap) {
+		if ((e = realloc(ev, (cap = cap ? cap * 2 : 65536) * sizeof(ev_t))) == NULL) return -1;
+		ev = e;
+	}
+	if (ts == FL_NOTS) {
+		if (src[s].last == INT64_MIN) {ts = 0; src[s].rel = 1;}
+		else ts = src[s].last + interval;
+		rel = src[s].rel;
+	} else if (src[s].rel) {src[s].rel = 0; src[s].last = INT64_MIN;}	//first timestamp: the relative clock ends
+	if (!rel && src[s].first == INT64_MAX) src[s].first = ts;
+	if (ts < src[s].last) ts = src[s].last;	//clock stepped back: the order of the lines wins
+	src[s].last = ts;
+	ev[nev].ts = ts; ev[nev].seq = nev; ev[nev].src = s; ev[nev].rel = rel;
+	ev[nev].p = p; ev[nev].n = n;
+	nev += 1;
+	return 0;
+}
+
+//anchor the lines without a timestamp at the start of their source to the earliest recorded
+//timestamp (0 if there is none), no later than the source's own first one
+static void ev_anchor(void) {
+	int64_t t0 = INT64_MAX;
+	size_t i;
+	int s;
+
+	for (s = 0; s < nsrc; s++) if (src[s].first < t0) t0 = src[s].first;
+	if (t0 == INT64_MAX) t0 = 0;
+	for (i = 0; i < nev; i++) if (ev[i].rel) {
+		ev[i].ts += t0;
+		if (ev[i].ts > src[ev[i].src].first) ev[i].ts = src[ev[i].src].first;	//input order kept by seq
+	}
+}
+
+//load a columnar file: the readings, as the firmware prints them
+static int load_col(const char *path, int s) {
+	cs_t cs;
+	char *t, *p;
+	size_t i;
+
+	if (cs_read(path, &cs)) return -1;
+	if ((p = t = malloc(cs.n * 32 + 1)) == NULL) {cs_free(&cs); return -1;}	//kept for the whole replay
+	for (i = 0; i < cs.n; p += ev[nev - 1].n, i++)
+		if (ev_add(s, cs.ts[i], p, sprintf(p, "freq = %10u.%03uHz.", cs.freq[i], cs.frac[i]))) {cs_free(&cs); return -1;}
+	cs_free(&cs);
+	return 0;
+}
+
+//load a log file, mapped for the whole replay. aggd: "[ts] device line" lines
+static int load_log(const char *path, int s, int aggd) {
+	const char *p, *end, *le, *q, *r;
+	struct stat st;
+	int64_t ts;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) return -1;
+	if (fstat(fd, &st)) {close(fd); return -1;}
+	if (st.st_size == 0) {close(fd); return 0;}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return -1;
+	for (end = p + st.st_size; p < end; p = le + 1) {
+		if ((le = memchr(p, '\n', end - p)) == NULL) le = end;
+		for (q = le; q > p && (q[-1] == '\r' || q[-1] == ' '); q--) continue;	//line end, "\r\n" or "\n\r" alike
+		while (p < q && *p == '\r') p++;
+		if (p == q) continue;			//blank
+		ts = fl_parse_ts(p, q, &r);
+		if (aggd) {						//device name, then the line
+			for (p = r; r < q && *r != ' '; r++) continue;
+			if (ts == FL_NOTS || r == q || (s = src_get(p, r - p)) < 0) continue;	//not aggd output
+			r += 1;
+		}
+		if (ev_add(s, ts, r, q - r)) return -1;
+	}
+	return 0;
+}
+
+//order of replay: time, then input order
+static int ev_cmp(const void *a, const void *b) {
+	const ev_t *x = a, *y = b;
+	if (x->ts != y->ts) return (x->ts < y->ts) ? -1 : 1;
+	return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+//open a pty, raw, no echo
+static int pty_open(pty_t *t) {
+	struct termios tio;
+
+	if ((t->m = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0 || grantpt(t->m) || unlockpt(t->m)) return -1;
+	if ((t->s = open(ptsname(t->m), O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) return -1;
+	if (tcgetattr(t->s, &tio) == 0) {cfmakeraw(&tio); tcsetattr(t->s, TCSANOW, &tio);}
+	t->n = 0;
+	return 0;
+}
+
+static int pty_flush(pty_t *t) {
+	size_t k = 0;
+	ssize_t w;
+
+	while (k < t->n) {					//blocks while the pty is full: as fast as the reader goes
+		if ((w = write(t->m, t->buf + k, t->n - k)) < 0) return -1;
+		k += w;
+	}
+	t->n = 0;
+	return 0;
+}
+
+//queue a line (n < PTY_BUF)
+static int pty_put(pty_t *t, const char *p, size_t n) {
+	if (t->n + n > PTY_BUF && pty_flush(t)) return -1;
+	memcpy(t->buf + t->n, p, n);
+	t->n += n;
+	return 0;
+}
+
+//a line in its wire form, in buf. return its length
+static size_t wire(const ev_t *e, char *buf, size_t size) {
+	uint16_t s1 = 0, s2 = 0;
+	fl_rec_t fl;
+	size_t i;
+
+	if (binary && fl_parse_line(e->p, e->p + e->n, &fl)) {	//a reading: frame it
+		buf[0] = FR_SYNC0; buf[1] = FR_SYNC1; buf[2] = FR_READING; buf[3] = 6;
+		for (i = 0; i < 4; i++) buf[4 + i] = fl.freq >> (8 * i);
+		buf[8] = fl.frac; buf[9] = fl.frac >> 8;
+		for (i = 2; i < 10; i++) {s1 = (s1 + (uint8_t) buf[i]) % 255; s2 = (s2 + s1) % 255;}
+		buf[10] = s1; buf[11] = s2;
+		return 12;
+	}
+	return snprintf(buf, size, "%.*s" EOL, (int) ((e->n < size - 3) ? e->n : size - 3), e->p);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: replay [-x speed] [-n copies] [-a] [-b] [-i interval_s] [-w wait_s] file...\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	double speed = 1, wait = 1;
+	int opt, aggd = 0, f, s, c;
+	int64_t t0, start, due, t;
+	struct timespec ts;
+	const char *name;
+	char line[1024];
+	size_t i, n;
+	uint32_t magic;
+	FILE *fp;
+
+	while ((opt = getopt(argc, argv, "x:n:abi:w:h")) != -1) {
+		switch (opt) {
+			case 'x': speed = atof(optarg); break;
+			case 'n': if ((copies = atoi(optarg)) < 1) usage(); break;
+			case 'a': aggd = 1; break;
+			case 'b': binary = 1; break;
+			case 'i': interval = atof(optarg) * 1e9; break;
+			case 'w': wait = atof(optarg); break;
+			default: usage();
+		}
+	}
+	if (optind == argc) usage();
+	for (f = optind; f < argc; f++) {	//load everything: the sources are merged on one clock
+		name = (name = strrchr(argv[f], '/')) ? name + 1 : argv[f];
+		magic = 0;
+		if ((fp = fopen(argv[f], "rb"))) {if (fread(&magic, 4, 1, fp) != 1) magic = 0; fclose(fp);}
+		s = aggd ? -1 : src_get(name, strlen(name));
+		if (s < 0 && !aggd) {fprintf(stderr, "replay: too many sources\n"); return 1;}
+		if ((magic == CS_MAGIC) ? load_col(argv[f], s) : load_log(argv[f], s, aggd)) {perror(argv[f]); return 1;}
+	}
+	if (nev == 0) {fprintf(stderr, "replay: nothing to replay\n"); return 1;}
+	ev_anchor();
+	qsort(ev, nev, sizeof(ev_t), ev_cmp);
+
+	for (s = 0; s < nsrc; s++) {		//the ptys, announced
+		if ((src[s].pty = malloc(copies * sizeof(pty_t))) == NULL) {perror("replay"); return 1;}
+		for (c = 0; c < copies; c++) {
+			if (pty_open(&src[s].pty[c])) {perror("pty"); return 1;}
+			printf("%s %s\n", ptsname(src[s].pty[c].m), src[s].name);
+		}
+	}
+	fflush(stdout);
+	ts.tv_sec = wait; ts.tv_nsec = (wait - ts.tv_sec) * 1e9;
+	nanosleep(&ts, NULL);
+
+	fprintf(stderr, "replay: %zu lines from %d sources to %d ptys, %.1fs recorded, x%g\n", nev, nsrc, nsrc * copies,
+		(ev[nev - 1].ts - ev[0].ts) / 1e9, speed);
+	t0 = ev[0].ts;
+	start = now_ns();
+	for (i = 0; i < nev; i++) {
+		if (speed > 0 && (due = start + (int64_t) ((ev[i].ts - t0) / speed)) > now_ns()) {	//early: send what's queued, then wait
+			for (s = 0; s < nsrc; s++) for (c = 0; c < copies; c++) pty_flush(&src[s].pty[c]);
+			ts.tv_sec = due / 1000000000; ts.tv_nsec = due % 1000000000;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+		n = wire(&ev[i], line, sizeof(line));
+		for (c = 0; c < copies; c++)
+			if (pty_put(&src[ev[i].src].pty[c], line, n)) {perror("pty"); return 1;}
+	}
+	for (s = 0; s < nsrc; s++) for (c = 0; c < copies; c++) pty_flush(&src[s].pty[c]);
+	t = now_ns() - start;
+	fprintf(stderr, "replay: done in %.3fs, %.0f lines/s\n", t / 1e9, nev * (double) copies / (t / 1e9));
+	ts.tv_sec = wait; ts.tv_nsec = (wait - ts.tv_sec) * 1e9;
+	nanosleep(&ts, NULL);				//for the readers to drain the ptys before they hang up
+	return 0;
+}
@@ -0,0 +1,119 @@
+//source file for the shared-memory ring of live readings
+//single writer, many readers, per-slot sequence numbers. see shmring.h
+
+#include <stdio.h>						//we use snprintf
+#include <string.h>						//we use strncpy
+#include <fcntl.h>						//we use O_CREAT
+#include <unistd.h>						//we use ftruncate
+#include <sys/mman.h>					//we use shm_open, mmap
+#include <sys/stat.h>					//we use fstat
+#include "shmring.h"					//we use shared-memory ring
+
+//global defines
+#define SHR_LOAD(x, o)			__atomic_load_n(&(x), o)
+#define SHR_STORE(x, v, o)		__atomic_store_n(&(x), v, o)
+
+//global variables
+
+//posix shm names start with a '/': added if missing
+static const char *shr_path(char *buf, size_t n, const char *name) {
+	if (name[0] == '/') return name;
+	snprintf(buf, n, "/%s", name);
+	return buf;
+}
+
+//create the ring
+int shr_create(shr_t *r, const char *name, uint32_t slots) {
+	char buf[256];
+	uint32_t n = 1;
+	int fd;
+
+	while (n < slots && n < (1ul << 30)) n <<= 1;	//a power of 2: slot index = reading number & (n - 1)
+	r->size = sizeof(shr_hdr_t) + (uint64_t) n * sizeof(shr_slot_t);
+	r->cur = r->lost = 0;
+	r->h = NULL;
+	if ((fd = shm_open(shr_path(buf, sizeof(buf), name), O_CREAT | O_RDWR | O_TRUNC, 0644)) < 0) return -1;
+	if (ftruncate(fd, r->size) == 0)
+		r->h = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);	//zero-filled: all slots empty
+	close(fd);
+	if (r->h == NULL || r->h == MAP_FAILED) {r->h = NULL; return -1;}
+	r->h->ver = SHR_VER;
+	r->h->slots = n;
+	SHR_STORE(r->h->magic, SHR_MAGIC, __ATOMIC_RELEASE);	//last: the header is complete
+	return 0;
+}
+
+//name a device
+void shr_setname(shr_t *r, uint16_t dev, const char *name) {
+	if (dev >= SHR_DEV_MAX) return;
+	strncpy(r->h->name[dev], name, SHR_NAME_MAX - 1);
+	if (dev >= r->h->ndev) SHR_STORE(r->h->ndev, dev + 1u, __ATOMIC_RELEASE);
+}
+
+//publish one reading
+void shr_put(shr_t *r, const shr_rec_t *rec) {
+	uint64_t head = r->h->head;			//only the writer changes it
+	shr_slot_t *s = &r->h->slot[head & (r->h->slots - 1)];
+
+	SHR_STORE(s->seq, 0, __ATOMIC_RELAXED);	//being written: readers skip it
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	s->rec = *rec;
+	SHR_STORE(s->seq, head + 1, __ATOMIC_RELEASE);	//complete
+	SHR_STORE(r->h->head, head + 1, __ATOMIC_RELEASE);
+}
+
+//attach to the ring
+int shr_open(shr_t *r, const char *name) {
+	char buf[256];
+	struct stat st;
+	int fd;
+
+	r->h = NULL;
+	r->lost = 0;
+	if ((fd = shm_open(shr_path(buf, sizeof(buf), name), O_RDONLY, 0)) < 0) return -1;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(shr_hdr_t))
+		r->h = mmap(NULL, r->size = st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (r->h == NULL || r->h == MAP_FAILED) {r->h = NULL; return -1;}
+	if (SHR_LOAD(r->h->magic, __ATOMIC_ACQUIRE) != SHR_MAGIC || r->h->ver != SHR_VER ||
+		sizeof(shr_hdr_t) + (uint64_t) r->h->slots * sizeof(shr_slot_t) > r->size) {
+		munmap(r->h, r->size); r->h = NULL;
+		return -1;
+	}
+	r->cur = SHR_LOAD(r->h->head, __ATOMIC_ACQUIRE);
+	return 0;
+}
+
+//next reading
+int shr_get(shr_t *r, shr_rec_t *rec) {
+	uint64_t head, seq, slots = r->h->slots;
+	const shr_slot_t *s;
+
+	for (;;) {
+		head = SHR_LOAD(r->h->head, __ATOMIC_ACQUIRE);
+		if (r->cur >= head) return 0;	//nothing new
+		if (head - r->cur > slots) {r->lost += head - slots - r->cur; r->cur = head - slots;}	//lapped: jump to the oldest
+		s = &r->h->slot[r->cur & (slots - 1)];
+		seq = SHR_LOAD(s->seq, __ATOMIC_ACQUIRE);
+		if (seq == r->cur + 1) {
+			*rec = s->rec;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (SHR_LOAD(s->seq, __ATOMIC_RELAXED) == seq) {r->cur += 1; return 1;}	//not overwritten during the copy
+		}
+		r->lost += 1; r->cur += 1;		//overwritten, or being overwritten: lost
+	}
+}
+
+//name of a device
+const char *shr_name(const shr_t *r, uint16_t dev) {
+	return (dev < SHR_LOAD(r->h->ndev, __ATOMIC_ACQUIRE)) ? r->h->name[dev] : "";
+}
+
+//detach
+void shr_close(shr_t *r, const char *name, int unlink) {
+	char buf[256];
+
+	if (r->h) munmap(r->h, r->size);
+	r->h = NULL;
+	if (unlink) shm_unlink(shr_path(buf, sizeof(buf), name));
+}
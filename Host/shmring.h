@@ -0,0 +1,75 @@
+#ifndef SHMRING_H_INCLUDED
+#define SHMRING_H_INCLUDED
+
+#include <stdint.h>						//we use uint64_t
+
+//shared-memory ring of live readings: one writer (aggd), any number of readers
+//posix shared memory, /dev/shm/<name>: header, then a power-of-2 number of slots
+//the writer never waits for the readers: it overwrites the oldest slot. each reader keeps its
+//own cursor (the number of the next reading it wants) and detects being overrun.
+//each slot carries its own sequence number, written last by the writer and checked before and
+//after a copy by the reader - no locks, no syscalls once mapped.
+
+//global defines
+#define SHR_MAGIC				0x52485350ul		//"PSHR"
+#define SHR_VER					1
+#define SHR_SLOTS				4096				//default number of slots
+#define SHR_DEV_MAX				1024				//max. number of devices named in the header
+#define SHR_NAME_MAX			32					//max. length of a device name, with the 0
+
+//one reading
+typedef struct {
+	int64_t ts;							//time of arrival, ns since the epoch
+	uint32_t freq;						//frequency, integer part, Hz
+	uint16_t frac;						//frequency, fractional part, 1/1000 Hz
+	uint16_t dev;						//device index, see shr_name()
+} shr_rec_t;
+
+//shared memory layout
+typedef struct {
+	uint64_t seq;						//reading number + 1 once written, 0 while being written
+	shr_rec_t rec;
+} shr_slot_t;
+
+typedef struct {
+	uint32_t magic, ver;
+	uint32_t slots;						//number of slots, a power of 2
+	uint32_t ndev;						//number of named devices
+	uint64_t head;						//number of readings written so far
+	char name[SHR_DEV_MAX][SHR_NAME_MAX];	//device names
+	shr_slot_t slot[];
+} shr_hdr_t;
+
+//a writer's or reader's view of the ring
+typedef struct {
+	shr_hdr_t *h;						//mapping
+	uint64_t size;						//its size, bytes
+	uint64_t cur;						//reader: number of the next reading
+	uint64_t lost;						//reader: readings overwritten before they could be read
+} shr_t;
+
+//global variables
+
+//create (or re-create) the ring, as the writer. slots: rounded up to a power of 2. return 0 if successful
+int shr_create(shr_t *r, const char *name, uint32_t slots);
+
+//name device dev, as the writer
+void shr_setname(shr_t *r, uint16_t dev, const char *name);
+
+//publish one reading, as the writer
+void shr_put(shr_t *r, const shr_rec_t *rec);
+
+//attach to the ring, as a reader. the cursor starts at the newest reading. return 0 if successful
+int shr_open(shr_t *r, const char *name);
+
+//next reading, as a reader. return 1 if *rec was filled in, 0 if there is none yet
+//readings overwritten before they could be read are skipped and counted in r->lost
+int shr_get(shr_t *r, shr_rec_t *rec);
+
+//name of device dev, "" if unknown
+const char *shr_name(const shr_t *r, uint16_t dev);
+
+//detach, and remove the ring if unlink
+void shr_close(shr_t *r, const char *name, int unlink);
+
+#endif /* SHMRING_H_INCLUDED */
@@ -0,0 +1,74 @@
+//shmtail.c
+//Reader of the shared-memory ring published by aggd -m (see shmring.h)
+//
+//Prints the readings as they arrive, one per line:
+//  [seconds.nanoseconds] device freq = N.fffHz.
+//Any number of shmtail (or other readers) may run at once: each has its own cursor, and none
+//can slow aggd down - a reader that falls more than a ring behind loses the oldest readings,
+//and is told so on stderr.
+//
+//Usage:
+//  shmtail [-a] [-d device] [-p poll_ms] shm_name
+//
+//  -a start with the oldest reading still in the ring, instead of the next one
+//  -d only the readings of this device
+//  -p polling period when the ring is empty, default 10ms
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use exit
+#include <stdint.h>						//we use uint64_t
+#include <string.h>						//we use strcmp
+#include <time.h>						//we use nanosleep
+#include <unistd.h>						//we use getopt
+#include <signal.h>						//we use signal
+#include "shmring.h"					//we use shared-memory ring
+
+//global defines
+
+//global variables
+static volatile sig_atomic_t quit = 0;	//1->terminate
+
+static void on_signal(int sig) {quit = 1;}
+
+static void usage(void) {
+	fprintf(stderr, "usage: shmtail [-a] [-d device] [-p poll_ms] shm_name\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	struct timespec poll = {0, 10000000};
+	const char *only = NULL;
+	uint64_t lost = 0;
+	shr_rec_t rec;
+	shr_t r;
+	int opt, all = 0, got;
+
+	while ((opt = getopt(argc, argv, "ad:p:h")) != -1) {
+		switch (opt) {
+			case 'a': all = 1; break;
+			case 'd': only = optarg; break;
+			case 'p': poll.tv_sec = atoi(optarg) / 1000; poll.tv_nsec = atoi(optarg) % 1000 * 1000000l; break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 1) usage();
+	if (shr_open(&r, argv[optind])) {perror(argv[optind]); return 1;}
+	if (all) r.cur = (r.cur > r.h->slots) ? r.cur - r.h->slots : 0;
+	signal(SIGINT, on_signal); signal(SIGTERM, on_signal);
+
+	while (!quit) {
+		for (got = 0; shr_get(&r, &rec); got = 1) {
+			if (only && strcmp(only, shr_name(&r, rec.dev))) continue;
+			printf("[%lld.%09lld] %s freq = %10u.%03uHz.\n", (long long) (rec.ts / 1000000000), (long long) (rec.ts % 1000000000),
+				shr_name(&r, rec.dev), rec.freq, rec.frac);
+		}
+		if (r.lost != lost) {fprintf(stderr, "shmtail: %llu readings lost\n", (unsigned long long) (r.lost - lost)); lost = r.lost;}
+		if (got) fflush(stdout);
+		else nanosleep(&poll, NULL);	//nothing new: the ring is polled, aggd doesn't signal the readers
+	}
+	shr_close(&r, argv[optind], 0);
+	return 0;
+}
@@ -0,0 +1,153 @@
+//snapstress.c
+//Stress test of the isr status snapshot of the 8-bit ports: cap_snap, cap_seq and snap_read()
+//
+//The firmware's isr update and snap_read() are copied here as they are. A posix timer signal
+//plays the capture isr: it interrupts the reader anywhere in its copy, as often as the kernel
+//allows, and updates cap_snap under the 8-bit cap_seq - which wraps every 128 updates. All
+//fields of an update are derived from the same gate count, so a torn snapshot shows up as
+//fields that disagree. Exits 1 if snap_read() ever returns one.
+//An 8-bit cap_seq covers up to 127 updates during one copy: 128 bring it back to where it was.
+//The isr runs once per gate, so the firmware never comes close; here the signals can outrun the
+//reader on a loaded machine. A torn read with 128+ updates during its snap_read() is counted as
+//outrun - beyond what the counter is for - not as a failure.
+//-u reads without the sequence counter instead: that has to tear, which shows the test can tell.
+//
+//Usage:
+//  snapstress [-t seconds] [-p period_us] [-u]
+//
+//  -t duration, default 2s
+//  -p isr period, default 5us, at least 2us: any faster and the signals starve the reader
+//  -u unprotected reads, expected to fail
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use atof
+#include <stdint.h>						//we use uint8_t
+#include <signal.h>						//we use sigaction
+#include <time.h>						//we use timer_create
+#include <unistd.h>						//we use getopt
+
+//global defines
+#define F_CLK		40000000l			//nominal interval, ticks
+#define TICKS(g)	(F_CLK + 3 * (int32_t) (g))	//interval of an update: a function of its gate count
+
+//isr status, as in the firmware
+typedef struct {
+	int32_t ticks;						//latest interval
+	uint16_t gates;						//gates captured
+	uint16_t ovf;						//records dropped, cap_ovf
+} snap_t;
+
+//global variables
+volatile snap_t cap_snap;				//isr status, multi-byte: read it through snap_read() only
+volatile uint8_t cap_seq = 0;			//cap_snap sequence counter: odd while the isr is updating it
+static volatile uint32_t isr_cnt = 0;	//updates made
+static uint64_t retries = 0;			//copies snap_read() had to redo
+
+static int64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+//the capture isr's update of cap_snap
+static void isr(int sig) {
+	uint16_t g = cap_snap.gates + 1;
+
+	cap_seq += 1;						//odd: cap_snap is being updated
+	cap_snap.ticks = TICKS(g);
+	cap_snap.gates = g;
+	cap_snap.ovf = ~g;					//stands in for cap_ovf
+	cap_seq += 1;						//even: cap_snap is consistent
+	isr_cnt += 1;
+}
+
+//the firmware's retry condition, counted
+static int snap_changed(uint8_t seq) {
+	if ((seq & 1) || seq != cap_seq) {retries += 1; return 1;}
+	return 0;
+}
+
+//consistent copy of the isr status, without masking interrupts
+//the copy is retried if the isr updated cap_snap in the middle of it
+static void snap_read(snap_t *snap) {
+	uint8_t seq;
+
+	do {
+		seq = cap_seq;
+		snap->ticks = cap_snap.ticks;
+		snap->gates = cap_snap.gates;
+		snap->ovf   = cap_snap.ovf;
+	} while (snap_changed(seq));
+}
+
+//the same, unprotected
+static void snap_read_u(snap_t *snap) {
+	snap->ticks = cap_snap.ticks;
+	snap->gates = cap_snap.gates;
+	snap->ovf   = cap_snap.ovf;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: snapstress [-t seconds] [-p period_us] [-u]\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	double secs = 2, period = 5;
+	int opt, k, unprot = 0;
+	uint64_t reads = 0, torn = 0, outrun = 0;
+	uint32_t n0;
+	int64_t end;
+	struct sigaction sa = {0};
+	struct sigevent sev = {0};
+	struct itimerspec its = {{0}};
+	timer_t tid;
+	snap_t s;
+
+	while ((opt = getopt(argc, argv, "t:p:uh")) != -1) {
+		switch (opt) {
+			case 't': secs = atof(optarg); break;
+			case 'p': period = atof(optarg); break;
+			case 'u': unprot = 1; break;
+			default: usage();
+		}
+	}
+	if (secs <= 0 || period < 2) usage();
+	cap_snap.ticks = TICKS(0); cap_snap.gates = 0; cap_snap.ovf = ~0;	//consistent before the first update
+
+	//the isr: a periodic timer signal
+	sa.sa_handler = isr;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &sa, NULL);
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGALRM;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &tid)) {perror("timer_create"); return 1;}
+	its.it_value.tv_nsec = its.it_interval.tv_nsec = period * 1000;
+	timer_settime(tid, 0, &its, NULL);
+
+	//main: read as fast as possible, check every snapshot
+	end = now_ns() + (int64_t) (secs * 1e9);
+	do {
+		for (k = 0; k < 4096; k++) {
+			n0 = isr_cnt;
+			if (unprot) snap_read_u(&s); else snap_read(&s);
+			if (s.ticks != TICKS(s.gates) || s.ovf != (uint16_t) ~s.gates) {
+				if (isr_cnt - n0 >= 128) outrun += 1; else torn += 1;
+			}
+		}
+		reads += 4096;
+	} while (now_ns() < end);
+	its.it_value.tv_nsec = its.it_interval.tv_nsec = 0;
+	timer_settime(tid, 0, &its, NULL);
+
+	printf("snapstress: %s, %llu reads, %u isr updates (cap_seq wrapped %u times), %llu retried copies, %llu torn, %llu outrun\n",
+		unprot ? "unprotected" : "snap_read()", (unsigned long long) reads, isr_cnt, isr_cnt / 128,
+		(unsigned long long) retries, (unsigned long long) torn, (unsigned long long) outrun);
+	if (torn) {printf("snapstress: FAIL\n"); return 1;}
+	printf("snapstress: pass\n");
+	return 0;
+}
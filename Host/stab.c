@@ -0,0 +1,228 @@
+//source file for the frequency stability statistics
+
+#include <stdlib.h>						//we use malloc
+#include <math.h>						//we use sqrt
+#include "stab.h"						//we use stability statistics
+
+//global defines
+typedef double v4d __attribute__((vector_size(32), aligned(8), may_alias));	//4 doubles: 2 sse2 or 1 avx register, unaligned
+typedef long long v4i __attribute__((vector_size(32)));	//shuffle masks
+#define stab_ld(p)			(*(const v4d *) (p))
+
+//global variables
+const char *stab_name[STAB_KINDS] = {"adev", "mdev", "hdev", "totdev"};
+
+//sum of (x[i + 2m] - 2x[i + m] + x[i])^2, i in [0, k)
+__attribute__((target_clones("avx2", "default")))
+static double stab_d2(const double *x, size_t k, size_t m) {
+	v4d a0 = {0}, a1 = {0}, d0, d1;
+	double s, d;
+	size_t i = 0;
+
+	for (; i + 8 <= k; i += 8) {		//two accumulators: the adds don't wait on each other
+		d0 = stab_ld(x + i + 2 * m) - 2 * stab_ld(x + i + m) + stab_ld(x + i);
+		d1 = stab_ld(x + i + 4 + 2 * m) - 2 * stab_ld(x + i + 4 + m) + stab_ld(x + i + 4);
+		a0 += d0 * d0; a1 += d1 * d1;
+	}
+	a0 += a1;
+	s = a0[0] + a0[1] + a0[2] + a0[3];
+	for (; i < k; i++) {d = x[i + 2 * m] - 2 * x[i + m] + x[i]; s += d * d;}
+	return s;
+}
+
+//sum of (x[i + 3m] - 3x[i + 2m] + 3x[i + m] - x[i])^2, i in [0, k)
+__attribute__((target_clones("avx2", "default")))
+static double stab_d3(const double *x, size_t k, size_t m) {
+	v4d a0 = {0}, a1 = {0}, d0, d1;
+	double s, d;
+	size_t i = 0;
+
+	for (; i + 8 <= k; i += 8) {
+		d0 = stab_ld(x + i + 3 * m) - 3 * stab_ld(x + i + 2 * m) + 3 * stab_ld(x + i + m) - stab_ld(x + i);
+		d1 = stab_ld(x + i + 4 + 3 * m) - 3 * stab_ld(x + i + 4 + 2 * m) + 3 * stab_ld(x + i + 4 + m) - stab_ld(x + i + 4);
+		a0 += d0 * d0; a1 += d1 * d1;
+	}
+	a0 += a1;
+	s = a0[0] + a0[1] + a0[2] + a0[3];
+	for (; i < k; i++) {d = x[i + 3 * m] - 3 * x[i + 2 * m] + 3 * x[i + m] - x[i]; s += d * d;}
+	return s;
+}
+
+//sum over j of s[j]^2, s[j] = sum of the m second differences from j, j in [0, k)
+//a running sum: s[j + 1] = s[j] + e[j], e[j] = second difference j + m in, j out = third difference at j.
+//4 at a time, as a prefix sum in the register: one dependent add per 4 j instead of 4
+__attribute__((target_clones("avx2", "default")))
+static double stab_mod(const double *x, size_t k, size_t m) {
+	const v4d z = {0};
+	v4d e, p, a = {0};
+	double s = 0, sum, d;
+	size_t i, j = 0;
+
+	for (i = 0; i < m; i++) s += x[i + 2 * m] - 2 * x[i + m] + x[i];
+	for (; j + 5 <= k; j += 4) {		//e[j .. j + 3] all used: j + 3 <= k - 2
+		e = stab_ld(x + j + 3 * m) - 3 * stab_ld(x + j + 2 * m) + 3 * stab_ld(x + j + m) - stab_ld(x + j);
+		p = e + __builtin_shuffle(e, z, (v4i) {4, 0, 1, 2});	//inclusive prefix sum of e
+		p = p + __builtin_shuffle(p, z, (v4i) {4, 5, 0, 1});
+		e = s + p - e;					//s[j .. j + 3]
+		a += e * e;
+		s += p[3];
+	}
+	sum = a[0] + a[1] + a[2] + a[3];
+	for (; ; j++) {
+		sum += s * s;
+		if (j + 1 == k) break;
+		d = x[j + 3 * m] - 3 * x[j + 2 * m] + 3 * x[j + m] - x[j];
+		s += d;
+	}
+	return sum;
+}
+
+//sum of (x*[i - m] - 2x[i] + x*[i + m])^2, i in [1, n - 2]
+//x*: the phase extended by reflection, x*[-k] = 2x[0] - x[k], x*[n - 1 + k] = 2x[n - 1] - x[n - 1 - k]
+//m <= (n - 1) / 2: only one end of a term is ever reflected
+static double stab_tot(const double *x, size_t n, size_t m) {
+	size_t lo = (m > 1) ? m : 1, hi = n - 1 - m, i;	//[lo, hi]: no reflection needed
+	double s = 0, d;
+
+	for (i = 1; i < lo; i++) {d = (2 * x[0] - x[m - i]) - 2 * x[i] + x[i + m]; s += d * d;}
+	s += stab_d2(x + lo - m, hi - lo + 1, m);
+	for (i = hi + 1; i <= n - 2; i++) {d = x[i - m] - 2 * x[i] + (2 * x[n - 1] - x[2 * (n - 1) - i - m]); s += d * d;}
+	return s;
+}
+
+//mtie: the deques hold indexes into x, the max deque with decreasing x, the min deque
+//with increasing x - their fronts are the max / min of the window
+double stab_mtie(const double *x, size_t n, size_t w) {
+	size_t size = 1, mask, *qx, *qn, hx = 0, tx = 0, hn = 0, tn = 0, i;	//[head, tail) of each, counting up, wrapped by mask
+	double mtie = 0;
+
+	if (w == 0 || w >= n) return -1;
+	while (size < w + 2) size <<= 1;	//the window, and the point that just left it
+	mask = size - 1;
+	if ((qx = malloc(2 * size * sizeof(size_t))) == NULL) return -1;
+	qn = qx + size;
+	for (i = 0; i < n; i++) {
+		while (tx > hx && x[qx[(tx - 1) & mask]] <= x[i]) tx--;	//dominated: can never be the max again
+		qx[tx++ & mask] = i;
+		while (tn > hn && x[qn[(tn - 1) & mask]] >= x[i]) tn--;
+		qn[tn++ & mask] = i;
+		if (i < w) continue;
+		if (qx[hx & mask] < i - w) hx++;	//slid out of the window: one at most per step
+		if (qn[hn & mask] < i - w) hn++;
+		if (x[qx[hx & mask]] - x[qn[hn & mask]] > mtie) mtie = x[qx[hx & mask]] - x[qn[hn & mask]];
+	}
+	free(qx);
+	return mtie;
+}
+
+//largest m
+size_t stab_mmax(int kind, size_t n) {
+	if (n < 4) return 0;
+	return (kind == STAB_MDEV || kind == STAB_HDEV) ? (n - 1) / 3 : (n - 1) / 2;
+}
+
+//variance at tau = m * tau0
+size_t stab_var(int kind, const double *x, size_t n, size_t m, double tau0, double *var) {
+	double tau = m * tau0;
+	size_t k;
+
+	if (m == 0 || m > stab_mmax(kind, n)) return 0;
+	switch (kind) {
+		case STAB_ADEV: k = n - 2 * m; *var = stab_d2(x, k, m) / (2 * tau * tau * k); break;
+		case STAB_MDEV: k = n - 3 * m + 1; *var = stab_mod(x, k, m) / (2.0 * m * m * tau * tau * k); break;
+		case STAB_HDEV: k = n - 3 * m; *var = stab_d3(x, k, m) / (6 * tau * tau * k); break;
+		case STAB_TOTDEV: k = n - 2; *var = stab_tot(x, n, m) / (2 * tau * tau * k); break;
+		default: return 0;
+	}
+	return k;
+}
+
+//equivalent degrees of freedom
+double stab_edf(int kind, size_t n, size_t m) {
+	double edf;
+
+	switch (kind) {
+		case STAB_ADEV: edf = (3.0 * (n - 1) / (2.0 * m) - 2.0 * (n - 2) / n) * 4.0 * m * m / (4.0 * m * m + 5); break;	//white fm, overlapping
+		case STAB_TOTDEV: edf = 1.5 * (n - 1) / m; break;	//white fm, howe
+		case STAB_MDEV: edf = (double) (n - 3 * m + 1) / m; break;	//independent terms
+		case STAB_HDEV: edf = (double) (n - 3 * m) / m; break;
+		default: edf = 1;
+	}
+	return (edf < 1) ? 1 : edf;
+}
+
+//chi-squared quantile for a z-score, wilson-hilferty
+static double stab_chi2(double nu, double z) {
+	double c = 1 - 2 / (9 * nu) + z * sqrt(2 / (9 * nu));
+	return (c > 0) ? nu * c * c * c : 0;
+}
+
+//start an incremental adev
+void stab_inc_init(stab_inc_t *s, double tau0) {
+	int k;
+
+	s->tau0 = tau0;
+	s->x = 0;
+	s->n = 1;							//point 0, x = 0: kept by all octaves
+	for (k = 0; k < STAB_OCT; k++) {s->oct[k].ring[0] = 0; s->oct[k].sum = 0; s->oct[k].terms = 0;}
+}
+
+//add one reading: a new phase point
+void stab_inc_add(stab_inc_t *s, double y) {
+	const int sub = __builtin_ctz(STAB_SUB);
+	uint64_t i = s->n, lag, j;
+	double d, *r;
+	int k, sh;
+
+	s->x += y * s->tau0;
+	s->n += 1;
+	for (k = 0; k < STAB_OCT; k++) {
+		sh = (k > sub) ? k - sub : 0;	//stride = 2^sh
+		if (i & ((1ull << sh) - 1)) break;	//not kept here, nor by any longer octave
+		lag = 1ull << (k - sh);			//tau, in kept points
+		j = i >> sh;
+		r = s->oct[k].ring;
+		r[j & (STAB_RING - 1)] = s->x;
+		if (j >= 2 * lag) {
+			d = s->x - 2 * r[(j - lag) & (STAB_RING - 1)] + r[(j - 2 * lag) & (STAB_RING - 1)];
+			s->oct[k].sum += d * d;
+			s->oct[k].terms += 1;
+		}
+	}
+}
+
+//adev at tau0 * 2^k
+uint64_t stab_inc_dev(const stab_inc_t *s, int k, double *dev) {
+	double tau = s->tau0 * (double) (1ull << k);
+
+	if (k < 0 || k >= STAB_OCT || s->oct[k].terms == 0) return 0;
+	*dev = sqrt(s->oct[k].sum / (2 * tau * tau * s->oct[k].terms));
+	return s->oct[k].terms;
+}
+
+//fractional frequency / phase of the readings
+double *stab_load(const cs_t *cs, int phase, double *tau0, double *f0) {
+	double sum = 0, *r;
+	size_t i;
+
+	if (*tau0 <= 0) *tau0 = (cs->n > 1 && cs->ts[0] != INT64_MIN && cs->ts[cs->n - 1] > cs->ts[0]) ? (cs->ts[cs->n - 1] - cs->ts[0]) * 1e-9 / (cs->n - 1) : 1;
+	if (*f0 <= 0) {						//mean, mHz
+		for (i = 0; i < cs->n; i++) sum += cs->freq[i] * 1000.0 + cs->frac[i];
+		*f0 = sum / cs->n;
+	}
+	if ((r = malloc((cs->n + (phase != 0)) * sizeof(double))) == NULL) return NULL;
+	if (phase == 0) {
+		for (i = 0; i < cs->n; i++) r[i] = (cs->freq[i] * 1000.0 + cs->frac[i] - *f0) / *f0;
+		return r;
+	}
+	for (r[0] = 0, i = 0; i < cs->n; i++) r[i + 1] = r[i] + (cs->freq[i] * 1000.0 + cs->frac[i] - *f0) / *f0 * *tau0;
+	return r;
+}
+
+//1-sigma confidence interval
+void stab_ci(double dev, double edf, double *lo, double *hi) {
+	double c = stab_chi2(edf, -1);
+
+	*lo = dev * sqrt(edf / stab_chi2(edf, 1));
+	*hi = (c > 0) ? dev * sqrt(edf / c) : INFINITY;
+}
@@ -0,0 +1,79 @@
+#ifndef STAB_H_INCLUDED
+#define STAB_H_INCLUDED
+
+#include <stddef.h>						//we use size_t
+#include <stdint.h>						//we use uint64_t
+#include "colstore.h"					//we use columnar store
+
+//frequency stability statistics of a phase record x[0..n), seconds, sampled every tau0 seconds,
+//at tau = m * tau0 - see NIST SP 1065:
+//  adev   overlapping allan deviation
+//  mdev   modified allan deviation
+//  hdev   overlapping hadamard deviation
+//  totdev total deviation, the phase extended by reflection at both ends
+//each is one O(n) pass per tau; the second / third differences run 4 doubles at a time.
+//the confidence intervals are 1-sigma (68.3%), chi-squared with the equivalent degrees of
+//freedom for white fm noise (adev, totdev) or the number of independent terms (mdev, hdev).
+
+//mtie at a window of w + 1 points (tau = w * tau0): the largest peak-to-peak phase in any window,
+//one O(n) pass with a monotonic deque each for the max and the min, of w + 2 entries at most.
+
+//incremental overlapping adev, for live curves: one phase point at a time, at the octave taus
+//tau0 * 2^k. octave k keeps the phase every s-th point, s = max(1, 2^k / STAB_SUB), in a ring
+//of the last 2 * STAB_SUB + 1 of them, and adds one second difference per kept point. up to
+//2^k = STAB_SUB this is the full overlapping adev; above, it overlaps every s points only -
+//same expectation, marginally wider confidence interval.
+//the strides are powers of 2: the octaves due at a point are a prefix of them, and the work
+//per point is O(1) amortized (~log2(STAB_SUB) + 2 octaves). memory: ~STAB_OCT * STAB_RING doubles.
+
+//global defines
+enum {STAB_ADEV, STAB_MDEV, STAB_HDEV, STAB_TOTDEV, STAB_KINDS};
+#define STAB_OCT				40					//octaves: tau0 .. 2^39 tau0
+#define STAB_SUB				16					//points per tau kept at the long taus
+#define STAB_RING				64					//ring per octave, a power of 2 > 2 * STAB_SUB
+
+//incremental adev state
+typedef struct {
+	double tau0;						//sampling interval, s
+	double x;							//phase of the newest point, s
+	uint64_t n;							//points so far
+	struct {
+		double ring[STAB_RING];			//phase, every stride-th point
+		double sum;						//sum of the squared second differences
+		uint64_t terms;					//number of them
+	} oct[STAB_OCT];
+} stab_inc_t;
+
+//global variables
+extern const char *stab_name[STAB_KINDS];	//"adev", ...
+
+//largest m that kind can be computed at, from n phase points
+size_t stab_mmax(int kind, size_t n);
+
+//variance of kind at tau = m * tau0 in *var. return the number of terms it is the average of, 0 if m is too large
+size_t stab_var(int kind, const double *x, size_t n, size_t m, double tau0, double *var);
+
+//equivalent degrees of freedom of kind at m, from n phase points
+double stab_edf(int kind, size_t n, size_t m);
+
+//1-sigma confidence interval [*lo, *hi] of a deviation with edf degrees of freedom
+void stab_ci(double dev, double edf, double *lo, double *hi);
+
+//mtie of x[0..n) over windows of w + 1 points. return it, -1 if w >= n or out of memory
+double stab_mtie(const double *x, size_t n, size_t w);
+
+//readings of a columnar file -> fractional frequency y[0..n), or phase x[0..n] = sum of y * tau0, from 0
+//*tau0 <= 0: set from the timestamps, 1s without them. *f0 <= 0: set to the mean reading, mHz
+//return y / x, malloc'ed: n / n + 1 points. NULL if out of memory
+double *stab_load(const cs_t *cs, int phase, double *tau0, double *f0);
+
+//start an incremental adev, sampling interval tau0
+void stab_inc_init(stab_inc_t *s, double tau0);
+
+//add one fractional frequency reading
+void stab_inc_add(stab_inc_t *s, double y);
+
+//adev at tau0 * 2^k in *dev. return the number of terms, 0 if none yet
+uint64_t stab_inc_dev(const stab_inc_t *s, int k, double *dev);
+
+#endif /* STAB_H_INCLUDED */
@@ -0,0 +1,197 @@
+//source file for the compressed time series
+//delta-of-delta timestamps and delta values, zig-zag varint coded, in independent blocks
+
+#include <stdlib.h>						//we use realloc
+#include <string.h>						//we use memcpy
+#include <unistd.h>						//we use ftruncate
+#include "tsz.h"						//we use compressed time series
+
+//global defines
+#define TSZ_ZZ(x)			(((uint64_t) (x) << 1) ^ (uint64_t) ((int64_t) (x) >> 63))	//zig-zag: small magnitudes -> small codes
+#define TSZ_UNZZ(x)			((int64_t) ((x) >> 1) ^ -(int64_t) ((x) & 1))
+
+//global variables
+
+//little-endian fields
+static void tsz_put32(uint8_t *p, uint32_t x) {memcpy(p, &x, 4);}
+static void tsz_put64(uint8_t *p, int64_t x) {memcpy(p, &x, 8);}
+static uint32_t tsz_get32(const uint8_t *p) {uint32_t x; memcpy(&x, p, 4); return x;}
+static int64_t tsz_get64(const uint8_t *p) {int64_t x; memcpy(&x, p, 8); return x;}
+
+//varint: 7 bits per byte, least significant first, msb set on all but the last byte
+static uint8_t *tsz_vput(uint8_t *p, uint64_t x) {
+	while (x >= 0x80) {*p++ = x | 0x80; x >>= 7;}
+	*p++ = x;
+	return p;
+}
+
+static const uint8_t *tsz_vget(const uint8_t *p, const uint8_t *end, uint64_t *x) {
+	uint64_t v = 0;
+	int s = 0;
+
+	while (p < end && s < 64) {
+		v |= (uint64_t) (*p & 0x7f) << s;
+		if ((*p++ & 0x80) == 0) {*x = v; return p;}
+		s += 7;
+	}
+	return NULL;						//truncated / corrupt
+}
+
+//read the block header at off, of a file size bytes long
+//return the offset of the next block, 0 if there is no complete block at off: the end of the chain
+static uint64_t tsz_next(FILE *fp, uint64_t off, uint64_t size, uint8_t *hdr) {
+	if (off + TSZ_BHDR > size) return 0;
+	if (fseek(fp, off, SEEK_SET) || fread(hdr, 1, TSZ_BHDR, fp) != TSZ_BHDR) return 0;
+	if (tsz_get32(hdr) != TSZ_BMAGIC || tsz_get32(hdr + 4) == 0 || tsz_get32(hdr + 4) > TSZ_BLK) return 0;
+	if (off + TSZ_BHDR + tsz_get32(hdr + 8) > size) return 0;	//cut short
+	return off + TSZ_BHDR + tsz_get32(hdr + 8);
+}
+
+//open a file for appending
+//anything after the last complete block, e.g. a block cut short by a crash, is cut off first:
+//left in place, the reader would stop there and never reach the appended blocks
+int tsz_wopen(tsz_w_t *w, const char *path) {
+	uint8_t hdr[TSZ_BHDR] = {0};
+	uint64_t off = TSZ_HDR, next, size;
+
+	w->n = 0;
+	if ((w->fp = fopen(path, "a+b")) == NULL) return -1;
+	if (fseek(w->fp, 0, SEEK_END) == 0 && ftell(w->fp) == 0) {	//new file: write the header
+		tsz_put32(hdr, TSZ_MAGIC); hdr[4] = TSZ_VER;
+		if (fwrite(hdr, 1, TSZ_HDR, w->fp) == TSZ_HDR) return 0;
+	} else {							//existing file: check the header
+		size = ftell(w->fp);
+		rewind(w->fp);
+		if (fread(hdr, 1, TSZ_HDR, w->fp) == TSZ_HDR && tsz_get32(hdr) == TSZ_MAGIC && hdr[4] == TSZ_VER) {
+			while ((next = tsz_next(w->fp, off, size, hdr)) != 0) off = next;	//hop to the end of the chain
+			if (off == size || (fflush(w->fp) == 0 && ftruncate(fileno(w->fp), off) == 0 && fseek(w->fp, 0, SEEK_END) == 0)) return 0;
+		}
+	}
+	fclose(w->fp); w->fp = NULL;
+	return -1;
+}
+
+//write the pending points as a block
+int tsz_flush(tsz_w_t *w) {
+	uint8_t hdr[TSZ_BHDR] = {0}, *p = w->buf;
+	int64_t d = 0, dn;
+	uint32_t i;
+
+	if (w->n == 0) return 0;
+	for (i = 1; i < w->n; i++) {
+		dn = (uint64_t) w->pt[i].ts - (uint64_t) w->pt[i - 1].ts;	//wraps instead of overflowing
+		p = tsz_vput(p, TSZ_ZZ((uint64_t) dn - (uint64_t) d));
+		p = tsz_vput(p, TSZ_ZZ((uint64_t) w->pt[i].v - (uint64_t) w->pt[i - 1].v));
+		d = dn;
+	}
+	tsz_put32(hdr, TSZ_BMAGIC);
+	tsz_put32(hdr + 4, w->n);
+	tsz_put32(hdr + 8, p - w->buf);
+	tsz_put64(hdr + 16, w->pt[0].ts);
+	tsz_put64(hdr + 24, w->pt[w->n - 1].ts);
+	tsz_put64(hdr + 32, w->pt[0].v);
+	w->n = 0;
+	if (fwrite(hdr, 1, TSZ_BHDR, w->fp) != TSZ_BHDR || fwrite(w->buf, 1, p - w->buf, w->fp) != (size_t) (p - w->buf)) return -1;
+	return fflush(w->fp) ? -1 : 0;		//a complete block on disk: safe to read by another process
+}
+
+//append one point
+int tsz_put(tsz_w_t *w, int64_t ts, int64_t v) {
+	w->pt[w->n].ts = ts;
+	w->pt[w->n].v = v;
+	w->n += 1;
+	return (w->n == TSZ_BLK) ? tsz_flush(w) : 0;
+}
+
+//flush and close
+int tsz_wclose(tsz_w_t *w) {
+	int err = tsz_flush(w);
+
+	if (fclose(w->fp)) err = -1;
+	w->fp = NULL;
+	return err;
+}
+
+//open a file for reading and index its blocks
+int tsz_ropen(tsz_r_t *r, const char *path) {
+	uint8_t hdr[TSZ_BHDR];
+	uint64_t off = TSZ_HDR, next, size;
+	tsz_blk_t *idx;
+
+	r->idx = NULL; r->nblk = 0; r->n = r->i = 0;
+	r->blk = (size_t) -1;				//no block loaded yet
+	if ((r->fp = fopen(path, "rb")) == NULL) return -1;
+	if (fread(hdr, 1, TSZ_HDR, r->fp) != TSZ_HDR || tsz_get32(hdr) != TSZ_MAGIC || hdr[4] != TSZ_VER) goto fail;
+	fseek(r->fp, 0, SEEK_END); size = ftell(r->fp);
+	while ((next = tsz_next(r->fp, off, size, hdr)) != 0) {	//hop from block header to block header, a block cut short is ignored
+		if ((r->nblk & 255) == 0) {
+			if ((idx = realloc(r->idx, (r->nblk + 256) * sizeof(tsz_blk_t))) == NULL) goto fail;
+			r->idx = idx;
+		}
+		r->idx[r->nblk].n = tsz_get32(hdr + 4);
+		r->idx[r->nblk].len = tsz_get32(hdr + 8);
+		r->idx[r->nblk].t0 = tsz_get64(hdr + 16);
+		r->idx[r->nblk].t1 = tsz_get64(hdr + 24);
+		r->idx[r->nblk].v0 = tsz_get64(hdr + 32);
+		r->idx[r->nblk].off = off + TSZ_BHDR;
+		r->nblk += 1;
+		off = next;
+	}
+	return 0;
+fail:
+	fclose(r->fp); free(r->idx);
+	r->fp = NULL; r->idx = NULL;
+	return -1;
+}
+
+//decode block k
+static int tsz_load(tsz_r_t *r, size_t k) {
+	const tsz_blk_t *b = &r->idx[k];
+	const uint8_t *p = r->buf, *end = r->buf + b->len;
+	uint64_t dd, dv;
+	int64_t d = 0;
+	uint32_t i;
+
+	if (b->len > sizeof(r->buf) || fseek(r->fp, b->off, SEEK_SET) || fread(r->buf, 1, b->len, r->fp) != b->len) return -1;
+	r->pt[0].ts = b->t0;
+	r->pt[0].v = b->v0;
+	for (i = 1; i < b->n; i++) {
+		if ((p = tsz_vget(p, end, &dd)) == NULL || (p = tsz_vget(p, end, &dv)) == NULL) return -1;
+		d = (uint64_t) d + (uint64_t) TSZ_UNZZ(dd);
+		r->pt[i].ts = (uint64_t) r->pt[i - 1].ts + (uint64_t) d;
+		r->pt[i].v = (uint64_t) r->pt[i - 1].v + (uint64_t) TSZ_UNZZ(dv);
+	}
+	r->blk = k; r->n = b->n; r->i = 0;
+	return 0;
+}
+
+//seek by time
+int tsz_seek(tsz_r_t *r, int64_t ts) {
+	size_t lo = 0, hi = r->nblk, mid;
+
+	while (lo < hi) {					//first block that ends at or after ts
+		mid = (lo + hi) / 2;
+		if (r->idx[mid].t1 < ts) lo = mid + 1; else hi = mid;
+	}
+	if (lo == r->nblk) {r->blk = r->nblk; r->n = r->i = 0; return -1;}
+	if (tsz_load(r, lo)) return -1;
+	while (r->i < r->n && r->pt[r->i].ts < ts) r->i += 1;
+	return 0;
+}
+
+//next point
+int tsz_get(tsz_r_t *r, tsz_pt_t *p) {
+	while (r->i == r->n) {				//current block used up: next one
+		if (r->blk + 1 >= r->nblk) return 0;
+		if (tsz_load(r, r->blk + 1)) return -1;
+	}
+	*p = r->pt[r->i++];
+	return 1;
+}
+
+//close the reader
+void tsz_rclose(tsz_r_t *r) {
+	if (r->fp) fclose(r->fp);
+	free(r->idx);
+	r->fp = NULL; r->idx = NULL;
+}
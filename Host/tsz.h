@@ -0,0 +1,89 @@
+#ifndef TSZ_H_INCLUDED
+#define TSZ_H_INCLUDED
+
+#include <stdio.h>						//we use FILE
+#include <stdint.h>						//we use int64_t
+
+//compressed time series of (timestamp, value) points, e.g. ns / mHz or ns / ticks
+//file: header, 8 bytes: magic "PPSZ", version (u16), reserved (u16)
+//      then self-contained blocks of up to TSZ_BLK points, little-endian:
+//      block header, 40 bytes: magic "PPSB", points (u32), payload bytes (u32), reserved (u32),
+//                              first / last timestamp (i64), first value (i64)
+//      payload: per point after the first, zig-zag varints of
+//               the timestamp delta-of-delta and the value delta
+//blocks are only ever appended: a file can be extended by a later run, and a block cut short
+//by a crash is ignored by the reader, and cut off by the next writer before it appends.
+//the block headers form the index used for seeking by time.
+//a steady 1pps stream costs ~1 byte per timestamp and 2-3 bytes per value.
+
+//global defines
+#define TSZ_MAGIC				0x5a535050ul		//"PPSZ"
+#define TSZ_BMAGIC				0x42535050ul		//"PPSB"
+#define TSZ_VER					1
+#define TSZ_HDR					8					//file header size, bytes
+#define TSZ_BHDR				40					//block header size, bytes
+#define TSZ_BLK					4096				//max. points per block
+#define TSZ_VMAX				10					//max. size of a varint, bytes
+
+//one point
+typedef struct {
+	int64_t ts;							//timestamp
+	int64_t v;							//value
+} tsz_pt_t;
+
+//one block, as indexed by the reader
+typedef struct {
+	int64_t t0, t1;						//first / last timestamp
+	int64_t v0;							//first value
+	uint64_t off;						//offset of the payload in the file
+	uint32_t n, len;					//points / payload bytes
+} tsz_blk_t;
+
+//writer
+typedef struct {
+	FILE *fp;							//file, opened for appending
+	tsz_pt_t pt[TSZ_BLK];				//points not yet written
+	uint32_t n;							//number of them
+	uint8_t buf[TSZ_BLK * 2 * TSZ_VMAX];	//payload being encoded
+} tsz_w_t;
+
+//reader
+typedef struct {
+	FILE *fp;							//file
+	tsz_blk_t *idx;						//block index
+	size_t nblk;						//blocks in the index
+	size_t blk;							//current block
+	tsz_pt_t pt[TSZ_BLK];				//its points, decoded
+	uint32_t n, i;						//number of them / next one
+	uint8_t buf[TSZ_BLK * 2 * TSZ_VMAX];	//payload being decoded
+} tsz_r_t;
+
+//global variables
+
+//open a file for appending, created if needed, anything after its last complete block cut off
+//return 0 if successful
+int tsz_wopen(tsz_w_t *w, const char *path);
+
+//append one point. a block is written every TSZ_BLK points. return 0 if successful
+int tsz_put(tsz_w_t *w, int64_t ts, int64_t v);
+
+//write the points not yet written as a (short) block, e.g. before a long pause. return 0 if successful
+int tsz_flush(tsz_w_t *w);
+
+//flush and close. return 0 if successful
+int tsz_wclose(tsz_w_t *w);
+
+//open a file for reading and index its blocks. return 0 if successful
+int tsz_ropen(tsz_r_t *r, const char *path);
+
+//position the reader at the first point with a timestamp >= ts - timestamps assumed ascending
+//return 0 if there is one, -1 otherwise
+int tsz_seek(tsz_r_t *r, int64_t ts);
+
+//next point. return 1 if *p was filled in, 0 at the end, -1 on a read error
+int tsz_get(tsz_r_t *r, tsz_pt_t *p);
+
+//close the reader
+void tsz_rclose(tsz_r_t *r);
+
+#endif /* TSZ_H_INCLUDED */
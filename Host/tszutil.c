@@ -0,0 +1,105 @@
+//tszutil.c
+//Packing / unpacking of compressed time series files (see tsz.h)
+//
+//Usage:
+//  tszutil -c out_file col_file...		append columnar files (see colstore.h) to a tsz file
+//  tszutil -x [-f from_s] [-t to_s] tsz_file	print the points as csv: timestamp (ns), frequency (Hz)
+//  tszutil -i tsz_file					print the block index and the compression ratio
+//
+//  values are stored in mHz: freq * 1000 + frac. from_s / to_s are seconds since the epoch,
+//  the start is found through the block index - the file isn't read up to it.
+//
+//v0.1: 10/18/2026 - initial release
+//
+
+#include <stdio.h>						//we use printf
+#include <stdlib.h>						//we use malloc
+#include <stdint.h>						//we use int64_t
+#include <unistd.h>						//we use getopt
+#include "colstore.h"					//we use columnar store
+#include "tsz.h"						//we use compressed time series
+
+//global defines
+
+//global variables
+static tsz_w_t w;						//writer, large: not on the stack
+static tsz_r_t r;						//reader
+
+static void usage(void) {
+	fprintf(stderr, "usage: tszutil -c out_file col_file...\n");
+	fprintf(stderr, "       tszutil -x [-f from_s] [-t to_s] tsz_file\n");
+	fprintf(stderr, "       tszutil -i tsz_file\n");
+	exit(1);
+}
+
+//append columnar files
+static int pack(const char *out, int argc, char *argv[]) {
+	size_t i, n = 0;
+	cs_t cs;
+	int f;
+
+	if (tsz_wopen(&w, out)) {perror(out); return 1;}
+	for (f = 0; f < argc; f++) {
+		if (cs_read(argv[f], &cs)) {perror(argv[f]); return 1;}
+		for (i = 0; i < cs.n; i++)
+			if (tsz_put(&w, cs.ts[i], (int64_t) cs.freq[i] * 1000 + cs.frac[i])) {perror(out); return 1;}
+		n += cs.n;
+		cs_free(&cs);
+	}
+	if (tsz_wclose(&w)) {perror(out); return 1;}
+	fprintf(stderr, "tszutil: %zu points appended to %s\n", n, out);
+	return 0;
+}
+
+//print the points in [from, to)
+static int unpack(const char *in, int64_t from, int64_t to) {
+	tsz_pt_t p;
+	int ret;
+
+	if (tsz_ropen(&r, in)) {perror(in); return 1;}
+	if (from != INT64_MIN && tsz_seek(&r, from)) {tsz_rclose(&r); return 0;}
+	printf("ts_ns,freq_hz\n");
+	while ((ret = tsz_get(&r, &p)) == 1 && p.ts < to)
+		printf("%lld,%lld.%03lld\n", (long long) p.ts, (long long) (p.v / 1000), (long long) (p.v % 1000));
+	tsz_rclose(&r);
+	if (ret < 0) {fprintf(stderr, "tszutil: %s: corrupt block\n", in); return 1;}
+	return 0;
+}
+
+//print the block index
+static int info(const char *in) {
+	uint64_t n = 0, bytes = TSZ_HDR;
+	size_t k;
+
+	if (tsz_ropen(&r, in)) {perror(in); return 1;}
+	printf("block,offset,points,bytes,t_first_ns,t_last_ns\n");
+	for (k = 0; k < r.nblk; k++) {
+		printf("%zu,%llu,%u,%u,%lld,%lld\n", k, (unsigned long long) r.idx[k].off - TSZ_BHDR, r.idx[k].n, r.idx[k].len + TSZ_BHDR,
+			(long long) r.idx[k].t0, (long long) r.idx[k].t1);
+		n += r.idx[k].n;
+		bytes += r.idx[k].len + TSZ_BHDR;
+	}
+	fprintf(stderr, "tszutil: %zu blocks, %llu points, %llu bytes, %.2f bytes/point\n", r.nblk, (unsigned long long) n,
+		(unsigned long long) bytes, n ? (double) bytes / n : 0.0);
+	tsz_rclose(&r);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	int64_t from = INT64_MIN, to = INT64_MAX;
+	int opt, mode = 0;
+
+	while ((opt = getopt(argc, argv, "cxif:t:h")) != -1) {
+		switch (opt) {
+			case 'c': case 'x': case 'i': mode = opt; break;
+			case 'f': from = atof(optarg) * 1e9; break;
+			case 't': to = atof(optarg) * 1e9; break;
+			default: usage();
+		}
+	}
+	if (mode == 'c' && argc - optind >= 2) return pack(argv[optind], argc - optind - 1, argv + optind + 1);
+	if (mode == 'x' && argc - optind == 1) return unpack(argv[optind], from, to);
+	if (mode == 'i' && argc - optind == 1) return info(argv[optind]);
+	usage();
+	return 1;
+}
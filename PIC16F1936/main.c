@@ -11,12 +11,17 @@
 //v0.5: 4/28/2018 - numerous minor improvements
 //v0.6: 4/28/2018 - ported to PIC24F
 //v0.7: 4/28/2018 - ported to PIC16F684 - no uart output
+//v0.8: 10/18/2026 - calibration saved to eeprom and used to seed the average on the next reset
+//v0.9: 10/18/2026 - non-blocking start: the isr acquires the first 1pps pulse, a watchdog reports when it's missing
+//v1.0: 10/18/2026 - captures passed to main through a ring, with an overflow count, instead of a single variable
+//v1.1: 10/18/2026 - isr status read by main through a sequence counter, without masking interrupts
+//v1.2: 10/18/2026 - optional external clock: the capture timebase counts an external oscillator on T1CKI, to measure it
 //
 //Connections:
 //
 //                              |---------------------|
 //      1PPS generator -------->|CCP4/RB0             |
-//                              |                     |
+//ext. osc. (optional) -------->|T1CKI/PC0            |
 //                              |                     |
 //                              |                     |
 //                              |                     |
@@ -43,13 +48,28 @@
 #include "gpio.h"						//we use gpio
 #include "delay.h"						//we use software delays
 //#include "uart1.h"						//we use uart
+#include "nvm.h"						//we use nonvolatile memory
 
 //hardware configuration
+//#define EXTCLK_USED					//the capture timebase counts an external oscillator on T1CKI, instead of the instruction clock. uncomment to use
+#define F_EXT		1000000ul			//nominal frequency of the external oscillator: within +/-32767Hz / PPS_CNT of the actual one
+										//the capture needs T1CKI synchronized, 1:1: period > Tcy + 40ns, i.e. < ~1.85MHz at F_CPU = 2MHz. divide faster oscillators down first
+#define EXTCLK_PIN()	IO_IN(TRISC, 1<<0)	//T1CKI/PC0, as input
+#if defined(EXTCLK_USED)
+#define F_CLK       F_EXT				//clock of oscillator to be measured, see F_EXT for its limit
+#else
 #define F_CLK       F_CPU				//clock of oscillator to be calibrated
+#endif
 #define PPS_CNT		1					//number of 1pps pulses to count
 #define PPS_PIN()	IO_IN(TRISB, 1<<0)	//1pps input pin assignment: CCP4/PB0
 #define FREQ_CNT	4					//weight used in smoothing algorithm
 //#define SET_PBDIV	2					//current setting of PBDIV, 1/2/4/8 (default)
+#define OSCTUN_DEF	0					//default INTOSC trim, OSCTUNE
+#define NV_USED							//calibration saved to eeprom, to seed the average on the next reset. comment out to disable
+#define NV_FIRST	600					//first save, gates after reset - the average has settled by then
+#define NV_EVERY	3600				//then one save every NV_EVERY gates - eeprom endurance is ~100k cycles
+
+#define PPS_TIMEOUT	2					//seconds without a 1pps pulse before it's reported missing and re-acquired
 
 #define LED_PORT	PORTA
 #define LED_DDR		TRISA
@@ -57,6 +77,37 @@
 //end hardware configuration
 
 //global defines
+#if defined(EXTCLK_USED)
+#define TxTCS		2					//timebase clock: external, T1CKI. synchronized, as the capture needs
+#else
+#define TxTCS		0					//timebase clock: internal, Fosc/4
+#endif
+#define FREQC_WAIT	0					//acquisition state: waiting for the first 1pps pulse
+#define FREQC_RUN	1					//acquisition state: gating
+#define CAP_N		4					//capture ring size, a power of 2
+#define CAP_FIRST	(1<<0)				//capture flag: first gate after (re)acquisition
+#define CAP_OVF		(1<<1)				//capture flag: records were dropped just before this one
+//capture record, from the isr to main
+typedef struct {
+	uint16_t tick;						//capture at the end of the gate
+	 int32_t ticks;						//ticks in the gate
+	 uint8_t flags;						//CAP_xxx
+} cap_t;
+//isr status, for main: written by the isr under cap_seq, copied out by snap_read()
+typedef struct {
+	 int32_t ticks;						//latest interval
+	uint16_t gates;						//gates captured
+	uint16_t ovf;						//records dropped, cap_ovf
+} snap_t;
+#if defined(EXTCLK_USED)
+#define CT_IF		TMR0IF				//coarse timebase for the 1pps watchdog: timer0 overflows, as timer1 counts the external clock
+#define CT_TICKS	(F_CPU / 256 / 256)	//timer0 overflows per second, 1:256 prescaler. PPS_TIMEOUT * CT_TICKS < 256
+#define CT_INIT()	do {OPTION_REG = (OPTION_REG & ~0x2f) | 0x07;} while (0)	//timer0 on Fosc/4, prescaler to timer0, 1:256
+#else
+#define CT_IF		TMR1IF				//coarse timebase for the 1pps watchdog: timer1 overflows
+#define CT_TICKS	(F_CPU / 65536)		//timer1 overflows per second. PPS_TIMEOUT * CT_TICKS < 256
+#define CT_INIT()						//timer1 is already running
+#endif
 #define TxCON		T1CON
 #define TMRx		TMR1
 //#define PRx			PR2
@@ -71,9 +122,22 @@
 volatile uint16_t tick0, tick1;			//16-bit captures
 volatile  int16_t freq_error;			//frequency error
 volatile  int32_t freq;					//frequency measurement
-volatile  uint8_t freq_available=0;		//1->new data available
+volatile   cap_t cap_buf[CAP_N];		//capture ring, single producer (isr) / single consumer (main)
+volatile  uint8_t cap_head=0;			//next slot to be written, by the isr only
+volatile  uint8_t cap_tail=0;			//next slot to be read, by main only
+volatile uint16_t cap_ovf=0;			//records dropped because the ring was full, written by the isr only
+volatile  uint8_t cap_flags=0;			//flags for the next record, isr only
+volatile  snap_t cap_snap;				//isr status, multi-byte: read it through snap_read() only
+volatile  uint8_t cap_seq=0;			//cap_snap sequence counter: odd while the isr is updating it
 volatile  uint8_t pps_cnt = PPS_CNT;	//current 1pps pulse count, downcounter
+volatile  uint8_t freqc_state = FREQC_WAIT;	//acquisition state
+volatile  uint8_t pps_seen = 0;		//1->a 1pps pulse has arrived, cleared by the watchdog in main
+uint8_t pps_time;						//watchdog timebase (CT_IF) overflows since the last 1pps pulse
 		  int32_t freq_sum, freq_avg, freq_i, freq_f;
+#if defined(NV_USED)
+nv_t nv;								//calibration record
+uint16_t nv_cnt;						//gates to the next save, downcounter
+#endif
 //char uRAM[80];							//transmitt buffer for uart
 //const char str0[]="freq =         Hz.\n\r";
 
@@ -84,12 +148,34 @@ void interrupt isr(void) {				//for PIC16/18
 	//clear the flag
 	tick1 = ICxBUF;						//read the capture buffer first
 	ICxIF = 0;							//clear the flag after the buffer has been read (the interrupt flag is persistent)
+	pps_seen = 1;						//for the watchdog
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start the gate on it
+		tick0 = tick1;
+		pps_cnt = PPS_CNT;
+		freqc_state = FREQC_RUN;
+		cap_flags |= CAP_FIRST;
+		return;
+	}
 	pps_cnt -= 1;						//decrement pps_cnt, a downcounter
 	if (pps_cnt == 0) {
 		pps_cnt = PPS_CNT;				//reset pps_cnt
-		freq_error = tick1 - (tick0 + F_CLK * PPS_CNT); freq = F_CLK * PPS_CNT + freq_error; //freq = freq << OSCCONbits.PBDIV;
+		freq_error = tick1 - (tick0 + F_CLK * PPS_CNT);
+		if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the record
+			cap_buf[cap_head % CAP_N].tick  = tick1;
+			cap_buf[cap_head % CAP_N].ticks = F_CLK * PPS_CNT + freq_error;
+			cap_buf[cap_head % CAP_N].flags = cap_flags;
+			cap_flags = 0;
+			cap_head += 1;				//publish the record, after it has been written
+		} else {						//ring full: drop the record
+			cap_ovf += 1;
+			cap_flags |= CAP_OVF;
+		}
+		cap_seq += 1;					//odd: cap_snap is being updated
+		cap_snap.ticks = F_CLK * PPS_CNT + freq_error;
+		cap_snap.gates += 1;
+		cap_snap.ovf = cap_ovf;
+		cap_seq += 1;					//even: cap_snap is consistent
 		tick0 = tick1;					//update tick0
-		freq_available = 1;				//new data available
 		IO_FLP(LED_PORT, LED);			//flip led
 	}
 	
@@ -105,12 +191,10 @@ void tmr1_init(void) {
 	//TxCON  = (TxCON &~(7<<4)) | (0<<4);	//0->1:1 prescaler, 1->2x prescaler, ...
 	//TxCON &=~(1<<3);					//0->16 bit mode, 1->32-bit mode
 	//TxCON &=~(1<<1);					//0->count on internal clock, 1->count on external clock
-	TxCON  = 	(0<< 7) |				//1->timer gate active high, 0->timer gate active low
-				(0<< 6) |				//1->gating enabled, 0->gating disabled
+	TxCON  = 	(TxTCS<< 6) |			//clock source: 0->Fosc/4, 1->Fosc, 2->T1CKI pin, 3->cap. sensing oscillator. gating is in T1GCON
 				(0<< 4) |				//0->1:1 prescaler, 1->2x prescaler, 2->4x prescaler, 3->8x prescaler, ..., 7->256x prescaler
 				(0<< 3) |				//1->low power oscillator enabled, 0->low power oscillator disabled
 				(0<< 2) |				//1->don't sync, 0->sync external clock input
-				(0<< 1) |				//0->count on internal clock, 1->count on external clock
 				(0<< 0) |				//0->timer stop'd, 1->timer enaled
 				0x00;
 	//TMRx = 0;							//reset the counter - optional
@@ -143,43 +227,77 @@ void ic4_init(void) {
 	//input capture running now
 }
 	
+//consistent copy of the isr status, without masking interrupts
+//the copy is retried if the isr updated cap_snap in the middle of it
+void snap_read(snap_t *snap) {
+	uint8_t seq;
+
+	do {
+		seq = cap_seq;
+		snap->ticks = cap_snap.ticks;
+		snap->gates = cap_snap.gates;
+		snap->ovf   = cap_snap.ovf;
+	} while ((seq & 1) || seq != cap_seq);
+}
+
 //reset frequency calibrator
 void freqc_init(void) {
 	//tick0=tick1=0;
-	freq_available = 0;					//0->no new data
+	cap_head = cap_tail = 0;			//empty capture ring
+	cap_flags = 0; cap_ovf = 0;
+	cap_seq = 0; cap_snap.ticks = 0; cap_snap.gates = cap_snap.ovf = 0;
 	freq = F_CLK;						//initial value of freq
 	pps_cnt = PPS_CNT;					//reset 1pps pulse counter, downcounter
 	freq_sum = (F_CLK) * FREQ_CNT;	//initialize freq_sum: PBDIV=8
 	freq_avg = freq_sum / FREQ_CNT;		//optional
+#if defined(NV_USED)
+	nv_cnt = NV_FIRST;					//reset the save counter
+	if (nv_read(&nv) == 0) {			//valid calibration from the last run: start from it
+		freq_sum = nv.freq * FREQ_CNT + (((uint16_t) nv.frac * FREQ_CNT) >> 8);
+		freq_avg = freq_sum / FREQ_CNT;
+	} else nv.trim = OSCTUN_DEF;		//no calibration: default trim
+#endif
 	
 	//optional - calibrate FRC
 	//DMA / interupts assumed disabled here
 	//SYSKEY = 0xaa996655ul; SYSKEY = 0x556699aaul;	//unlock sequence
 	//OSCTUN = -5;						//change osctun: 12.5% / 32
+#if defined(NV_USED)
+	OSCTUNE = nv.trim;					//change osctune: trim from the last run
+#endif
 	//SYSKEY = 0x33333333ul;				//lock by writing any non critical value
 	
+#if defined(EXTCLK_USED)
+	EXTCLK_PIN();						//external clock into T1CKI
+#endif
+	CT_INIT();							//watchdog timebase
 	tmr1_init();						//reset tmr2
 	//configure the input capture pin ICP1
 	PPS_PIN();
 	ic4_init();							//reset ic1
-	//wait for the first capture event
-	while (ICxIF == 0) continue;
-	tick0 = ICxBUF;						//read the first capture
-	ICxIF = 0;							//clear the flag after having read the buffer - flag is persistent so the read order has to be maintained
+	//don't wait for the first capture: the isr starts the gate on it
+	freqc_state = FREQC_WAIT;			//waiting for the first 1pps pulse
 	ICxIE = 1;							//enable the interrupt
 	PEIE = 1;							//enable peripheral interrupt
 }
 	
 int main(void) {
 	uint32_t tmp;
+	cap_t cap;							//current capture record
+#if defined(NV_USED)
+	snap_t snap;						//isr status
+	uint16_t nv_ovf = 0;				//cap_ovf at the last save
+#endif
 	
 	mcu_init();							//reset the mcu
 	IO_SET(LED_PORT, LED); IO_OUT(LED_DDR, LED);				//led as output
 	freqc_init();						//reset the frequency calibrator
 	ei();								//enable global interrupts
 	while (1) {
-		if (freq_available) {			//new data has arrived
-			freq_available = 0;			//data has been read, no new data now
+		while (cap_tail != cap_head) {	//new data has arrived: process every record in the ring
+			cap = cap_buf[cap_tail % CAP_N];	//copy the record out, then free its slot
+			cap_tail += 1;
+			freq = cap.ticks;			//frequency measurement
 			
 			//smoothing the reading
 			freq_sum += freq - freq_avg;
@@ -187,9 +305,34 @@ int main(void) {
 			//freq_i   = freq_sum / FREQ_CNT;
 			//calculate the fractional frequency
 			freq_f   = freq_sum - freq_avg * FREQ_CNT;
+#if defined(NV_USED)
+			//save the calibration - rarely, for eeprom endurance
+			if (--nv_cnt == 0) {
+				nv_cnt = NV_EVERY;
+				snap_read(&snap);
+				if (snap.ovf == nv_ovf) {	//no records dropped since the last save: the average is sound
+					nv.freq = freq_avg;
+					nv.frac = (freq_f << 8) / FREQ_CNT;
+					nv.trim = OSCTUNE;
+					nv_write(&nv);
+				}
+				nv_ovf = snap.ovf;
+			}
+#endif
 
 			//IO_FLP(LED_PORT, LED);		//flip the led
 		}	
+		//1pps watchdog: fast blink while it's missing, re-acquire when it comes back
+		if (CT_IF) {					//one watchdog timebase overflow
+			CT_IF = 0;
+			pps_time += 1;
+			if (freqc_state == FREQC_WAIT && (pps_time & 0x03) == 0) IO_FLP(LED_PORT, LED);
+		}
+		if (pps_seen) {pps_seen = 0; pps_time = 0;}
+		else if (pps_time > PPS_TIMEOUT * CT_TICKS) {
+			pps_time = 0;
+			freqc_state = FREQC_WAIT;	//the next pulse restarts the gate
+		}
 		//delay_ms(100);
 		//uart1_puts("testing...\n\r");
     }
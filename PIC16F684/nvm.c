@@ -0,0 +1,37 @@
+//source file for the nonvolatile calibration record in PIC16 data eeprom
+
+#include "nvm.h"						//we use nvm
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+
+//global variables
+
+//checksum: fletcher-16, keyed
+static uint16_t nv_chk(const uint8_t *p, uint8_t n) {
+	uint16_t s1 = 0, s2 = 0;
+
+	while (n--) {s1 = (s1 + *p++) % 255; s2 = (s2 + s1) % 255;}
+	return ((s2 << 8) | s1) ^ NV_KEY;
+}
+
+//read the calibration record
+int8_t nv_read(nv_t *nv) {
+	uint8_t *p = (uint8_t *) nv;
+	uint8_t i;
+
+	for (i = 0; i < sizeof(nv_t); i++) p[i] = eeprom_read(NV_ADDR + i);
+	return (nv->chk == nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk))) ? 0 : -1;
+}
+
+//write the calibration record
+void nv_write(nv_t *nv) {
+	const uint8_t *p = (const uint8_t *) nv;
+	uint8_t i;
+
+	nv->chk = nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk));
+	for (i = 0; i < sizeof(nv_t); i++)	//eeprom_write() waits for the previous write to finish
+		if (eeprom_read(NV_ADDR + i) != p[i]) eeprom_write(NV_ADDR + i, p[i]);
+}
@@ -0,0 +1,31 @@
+#ifndef NVM_H_INCLUDED
+#define NVM_H_INCLUDED
+
+#include "gpio.h"
+
+//hardware configuration
+#define NV_ADDR					0x00				//address of the record in data eeprom
+#define NV_KEY					0xa55a				//checksum key: blank eeprom (all 0x00 / 0xff) doesn't pass
+//end hardware configuration
+
+//global defines
+
+//calibration record, kept in data eeprom
+typedef struct {
+	int32_t freq;						//learned frequency, integer part, ticks per gate
+	uint8_t frac;						//learned frequency, fractional part, 1/256 tick
+	int8_t trim;						//oscillator trim, OSCTUNE
+	uint16_t chk;						//checksum over the fields above, filled in by nv_write()
+} nv_t;
+
+//global variables
+
+//read the calibration record
+//return 0 if valid, -1 if blank / corrupted
+int8_t nv_read(nv_t *nv);
+
+//write the calibration record
+//only the bytes that changed are written: ~5ms each, endurance ~100k cycles per byte
+void nv_write(nv_t *nv);
+
+#endif /* NVM_H_INCLUDED */
@@ -10,12 +10,20 @@
 //v0.4: 4/27/2018 - ported to PIC32MX
 //v0.5: 4/28/2018 - numerous minor improvements
 //v0.6: 4/28/2018 - ported to PIC24F
+//v0.7: 10/18/2026 - fixed-point kalman filter (phase, frequency, drift) as an alternative to the FREQ_CNT average
+//v0.8: 10/18/2026 - temperature compensation: frequency vs. temperature learned online from an adc sensor
+//v0.9: 10/18/2026 - calibration saved to flash and used to seed the filter on the next reset
+//v1.0: 10/18/2026 - non-blocking start: the isr acquires the first 1pps pulse, a watchdog reports when it's missing
+//v1.1: 10/18/2026 - captures passed to main through a ring, with an overflow count, instead of a single variable
+//v1.2: 10/18/2026 - optional deferred isr (raw captures queued, gate arithmetic in main), isr latency / duration measured
+//v1.3: 10/18/2026 - optional external clock: the capture timebase counts an external oscillator on T2CK, to measure it
 //
 //Connections:
 //
 //                              |---------------------|
 //      1PPS generator -------->|ICP1/RP4             |
-//                              |                     |
+//  MCP9700 (optional) -------->|AN0/RA0              |
+//ext. osc. (optional) -------->|T2CK/RP5             |
 //                              |                     |
 //                              |                     |
 //                              |                     |
@@ -42,13 +50,40 @@
 #include "gpio.h"						//we use gpio
 #include "delay.h"						//we use software delays
 #include "uart1.h"						//we use uart
+#include "kalman.h"						//we use kalman filter
+#include "adc1.h"						//we use adc
+#include "tempco.h"						//we use temperature compensation
+#include "nvm.h"						//we use nonvolatile memory
 
 //hardware configuration
+//#define EXTCLK_USED					//the capture timebase counts an external oscillator on T2CK, instead of the instruction clock. uncomment to use
+#define F_EXT		10000000ul			//nominal frequency of the external oscillator: within +/-32767Hz / PPS_CNT of the actual one
+#define EXTCLK_PIN()	do {PPS_T2CK_TO_RP(5); IO_IN(TRISB, 1<<5);} while (0)	//T2CK on RP5/RB5, as input
+#if defined(EXTCLK_USED)
+#define F_CLK       F_EXT				//clock of oscillator to be measured, up to the T2CK input limit
+#else
 #define F_CLK       F_CPU				//clock of oscillator to be calibrated
+#endif
 #define PPS_CNT		1					//number of 1pps pulses to count
 #define PPS_PIN()	PPS_IC1_TO_RP(4)	//1pps input pin assignment: A2/B6/A4/B13/B2/C6/C1/A3
 #define FREQ_CNT	4					//weight used in smoothing algorithm
 //#define SET_PBDIV	2					//current setting of PBDIV, 1/2/4/8 (default)
+#define OSCTUN_DEF	0					//default FRC trim, OSCTUN
+#define KF_USED							//smoothing by the kalman filter. comment out to use the FREQ_CNT average
+//#define TC_USED						//temperature compensation. uncomment to use
+#define TEMP_AN		0					//temperature sensor on AN0
+#define TEMP_PIN()	do {IO_IN(TRISA, 1<<0); AD1PCFG &=~(1<<0);} while (0)	//AN0/RA0 as analog input
+#define TEMP_MV_REF	3300				//adc reference, mv
+#define TEMP_MV_0C	500					//sensor output at 0C, mv. sensor slope assumed to be 10mv/C
+#define NV_USED							//calibration saved to flash, to seed the filter on the next reset. comment out to disable
+#define NV_FIRST	600					//first save, gates after reset - the filter has settled by then
+#define NV_EVERY	86400ul				//then one save every NV_EVERY gates - flash endurance is ~10k cycles
+
+#define PPS_TIMEOUT	2					//seconds without a 1pps pulse before it's reported missing and re-acquired
+//#define ISR_DEFER						//the isr only queues the raw capture, the gate arithmetic runs in main. uncomment to use
+//#define ISR_STATS						//worst-case isr latency / duration measured and reported. uncomment to use
+//isr cost at a gate's end, counted off the code at -O1 (estimates - ISR_STATS measures them on the part), Tcy:
+//  in-isr gate: ~50 + ~16 context save / restore. ISR_DEFER: ~26 + ~12. latency, edge to the first line: ~11 in both
 
 #define LED_PORT	LATB
 #define LED_DDR		TRISB
@@ -56,6 +91,31 @@
 //end hardware configuration
 
 //global defines
+#if defined(EXTCLK_USED)
+#define TxTCS		1					//timebase clock: 1->external, T2CK
+#else
+#define TxTCS		0					//timebase clock: 0->internal, instruction clock
+#endif
+#define FREQC_WAIT	0					//acquisition state: waiting for the first 1pps pulse
+#define FREQC_RUN	1					//acquisition state: gating
+#define CAP_N		8					//capture ring size, a power of 2
+#define CAP_FIRST	(1<<0)				//capture flag: first gate after (re)acquisition
+#define CAP_OVF		(1<<1)				//capture flag: records were dropped just before this one
+//capture record, from the isr to main
+typedef struct {
+	uint16_t tick;						//capture at the end of the gate
+	 int32_t ticks;						//ticks in the gate
+	 uint8_t flags;						//CAP_xxx
+} cap_t;
+#if defined(ISR_STATS)
+#define ISR_ENTER()	uint16_t isr_t0 = TMRx	//timebase on entry, after the compiler's context save
+#define ISR_EXIT()	do {if ((uint16_t) (isr_t0 - tick1) > isr_lat) isr_lat = isr_t0 - tick1; if ((uint16_t) (TMRx - isr_t0) > isr_dur) isr_dur = TMRx - isr_t0;} while (0)
+#else
+#define ISR_ENTER()
+#define ISR_EXIT()
+#endif
+#define CT_GET()	TMR1				//coarse timebase for the 1pps watchdog: timer1, free running
+#define CT_TICKS	(F_CPU / 256)		//timer1 ticks per second. PPS_TIMEOUT * CT_TICKS < 65536
 #define TxMD		PMD1bits.T2MD
 #define TxCON		T2CON
 #define TMRx		TMR2
@@ -71,29 +131,106 @@
 volatile uint16_t tick0, tick1;			//16-bit captures
 volatile  int16_t freq_error;			//frequency error
 volatile  int32_t freq;					//frequency measurement
-volatile  uint8_t freq_available=0;		//1->new data available
+volatile   cap_t cap_buf[CAP_N];		//capture ring, single producer (isr) / single consumer (main)
+volatile  uint8_t cap_head=0;			//next slot to be written, by the isr only
+volatile  uint8_t cap_tail=0;			//next slot to be read, by main only
+volatile uint16_t cap_ovf=0;			//records dropped because the ring was full, written by the isr only
+volatile  uint8_t cap_flags=0;			//flags for the next record, isr only
+#if defined(ISR_DEFER)
+uint8_t gate_flags=0;					//flags for the next gate, main only
+uint16_t gate_tick0;					//start of the gate, main only - tick0 / tick1 belong to the isr
+#endif
+#if defined(ISR_STATS)
+volatile uint16_t isr_lat=0, isr_dur=0;	//worst-case isr latency (edge to entry) / duration (entry to exit), TMRx ticks
+#endif
 volatile  uint8_t pps_cnt = PPS_CNT;	//current 1pps pulse count, downcounter
+volatile  uint8_t freqc_state = FREQC_WAIT;	//acquisition state
+volatile  uint8_t pps_seen = 0;		//1->a 1pps pulse has arrived, cleared by the watchdog in main
+uint16_t pps_time;						//time of the last 1pps pulse, CT_GET()
 		  int32_t freq_sum, freq_avg, freq_i, freq_f;
+#if defined(KF_USED)
+kf_t kf;								//kalman filter, kf.n = 0 -> not yet seeded
+uint32_t kf_frac;						//fractional part of the filtered frequency
+#endif
+#if defined(TC_USED)
+tc_t tc;								//frequency vs. temperature model
+uint16_t temp;							//temperature, 16x oversampled adc reading
+uint32_t tc_frac;						//fractional part of the predicted frequency
+#endif
+#if defined(NV_USED)
+nv_t nv;								//calibration record
+uint32_t nv_cnt;						//gates to the next save, downcounter
+#endif
 char uRAM[80];							//transmitt buffer for uart
 const char str0[]="freq =         Hz.\n\r";
 
 //input capture ISR
 //void __ISR(_INPUT_CAPTURE_1_VECTOR/*, ipl7*/) _IC1Interrupt(void) {
 void _ISR _IC1Interrupt(void) {
+	ISR_ENTER();						//for isr statistics
 	//clear the flag
 	tick1 = ICxBUF;						//read the capture buffer first
 	ICxIF = 0;							//clear the flag after the buffer has been read (the interrupt flag is persistent)
+	pps_seen = 1;						//for the watchdog
+#if defined(ISR_DEFER)
+	//queue the raw capture: the gate is worked out in main, by freqc_gate()
+	if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the capture
+		cap_buf[cap_head % CAP_N].tick  = tick1;
+		cap_buf[cap_head % CAP_N].flags = cap_flags;
+		cap_flags = 0;
+		cap_head += 1;					//publish the record, after it has been written
+	} else {							//ring full: drop the capture
+		cap_ovf += 1;
+		cap_flags |= CAP_OVF;
+	}
+	ISR_EXIT();
+	return;
+#endif
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start the gate on it
+		tick0 = tick1;
+		pps_cnt = PPS_CNT;
+		freqc_state = FREQC_RUN;
+		cap_flags |= CAP_FIRST;
+		ISR_EXIT();
+		return;
+	}
 	pps_cnt -= 1;						//decrement pps_cnt
 	if (pps_cnt == 0) {
 		pps_cnt = PPS_CNT;				//reset pps_cnt
-		freq_error = tick1 - (tick0 + F_CLK * PPS_CNT); freq = F_CLK * PPS_CNT + freq_error; //freq = freq << OSCCONbits.PBDIV;
+		freq_error = tick1 - (tick0 + F_CLK * PPS_CNT);
+		if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the record
+			cap_buf[cap_head % CAP_N].tick  = tick1;
+			cap_buf[cap_head % CAP_N].ticks = F_CLK * PPS_CNT + freq_error;
+			cap_buf[cap_head % CAP_N].flags = cap_flags;
+			cap_flags = 0;
+			cap_head += 1;				//publish the record, after it has been written
+		} else {						//ring full: drop the record
+			cap_ovf += 1;
+			cap_flags |= CAP_OVF;
+		}
 		tick0 = tick1;					//update tick0
-		freq_available = 1;				//new data available
 		IO_FLP(LED_PORT, LED);			//flip led
 	}
+	ISR_EXIT();
 	
 }
 	
+//reset timer1 as a coarse timebase for the 1pps watchdog
+//free running, 16-bit, 256x prescaler
+void tmr1_init(void) {
+	PMD1bits.T1MD = 0;					//0->enable power to timer
+	T1CON  = 	(0<<15) |				//1->start the timer, 0->stop the timer
+				(0<<13) |				//0->operate in idle, 1->don't operate in idle
+				(0<< 6) |				//1->gating enabled, 0->gating disabled
+				(3<< 4) |				//0->1:1 prescaler, 1->8x prescaler, 2->64x prescaler, 3->256x prescaler
+				(0<< 1) |				//0->count on internal clock, 1->count on external clock
+				0x00;
+	PR1  =0xffff;						//period = 0xffff
+	//now start the timer
+	T1CON |= (1<<15);					//1->start the timer, 0->stop the timer
+	//timer now running
+}
+
 //reset timer2 as timebase for input capture
 //free running, 16-bit
 void tmr2_init(void) {
@@ -109,7 +246,7 @@ void tmr2_init(void) {
 				(0<< 6) |				//1->gating enabled, 0->gating disabled
 				(0<< 4) |				//0->1:1 prescaler, 1->2x prescaler, 2->4x prescaler, 3->8x prescaler, ..., 7->256x prescaler
 				(0<< 3) |				//0->16 bit mode, 1->32-bit mode
-				(0<< 1) |				//0->count on internal clock, 1->count on external clock
+				(TxTCS<< 1) |			//0->count on internal clock, 1->count on external clock
 				0x00;
 	//TMRx = 0;							//reset the counter - optional
 	PRx  =0xffff;						//period = 0xffff
@@ -153,50 +290,169 @@ void ic1_init(void) {
 	//input capture running now
 }
 	
+#if defined(ISR_DEFER)
+//gate arithmetic on a raw capture queued by the isr, run in main
+//return 1 and fill in cap->ticks / cap->flags at the end of a gate, 0 otherwise
+uint8_t freqc_gate(cap_t *cap) {
+	uint16_t t1 = cap->tick;			//the isr rewrites tick1 on every edge: work on a local copy
+	int16_t err;						//frequency error
+
+	if (cap->flags & CAP_OVF) {			//captures were dropped: restart the gate on this one
+		freqc_state = FREQC_WAIT;
+		gate_flags |= CAP_OVF;
+	}
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start the gate on it
+		gate_tick0 = t1;
+		pps_cnt = PPS_CNT;
+		freqc_state = FREQC_RUN;
+		gate_flags |= CAP_FIRST;
+		return 0;
+	}
+	pps_cnt -= 1;						//decrement pps_cnt
+	if (pps_cnt) return 0;
+	pps_cnt = PPS_CNT;					//reset pps_cnt
+	err = t1 - (gate_tick0 + F_CLK * PPS_CNT);
+	cap->ticks = F_CLK * PPS_CNT + err;
+	cap->flags = gate_flags;
+	gate_flags = 0;
+	gate_tick0 = t1;					//update gate_tick0
+	IO_FLP(LED_PORT, LED);				//flip led
+	return 1;
+}
+#endif
+
 //reset frequency calibrator
 void freqc_init(void) {
 	//tick0=tick1=0;
-	freq_available = 0;					//0->no new data
+	cap_head = cap_tail = 0;			//empty capture ring
+	cap_flags = 0; cap_ovf = 0;
+#if defined(ISR_DEFER)
+	gate_flags = 0;
+#endif
 	freq = F_CLK;						//initial value of freq
 	pps_cnt = PPS_CNT;					//reset 1pps pulse counter, downcounter
 	freq_sum = (F_CLK) * FREQ_CNT;	//initialize freq_sum: PBDIV=8
 	freq_avg = freq_sum / FREQ_CNT;		//optional
+#if defined(KF_USED)
+	kf.n = 0;							//seed the kalman filter with the first reading
+#endif
+#if defined(NV_USED)
+	nv_cnt = NV_FIRST;					//reset the save counter
+	if (nv_read(&nv) == 0) {			//valid calibration from the last run: start from it
+#if defined(KF_USED)
+		kf_seed(&kf, nv.freq, nv.frac, nv.drift);
+#else
+		freq_sum = nv.freq * FREQ_CNT + (((uint64_t) nv.frac * FREQ_CNT) >> 32);
+		freq_avg = freq_sum / FREQ_CNT;
+#endif
+	} else nv.trim = OSCTUN_DEF;		//no calibration: default trim
+#endif
+#if defined(TC_USED)
+	tc_init(&tc);						//nothing learned yet
+	TEMP_PIN();							//temperature sensor pin as analog input
+	adc1_init();						//reset the adc
+#endif
 	
 	//optional - calibrate FRC
 	//DMA / interupts assumed disabled here
 	//SYSKEY = 0xaa996655ul; SYSKEY = 0x556699aaul;	//unlock sequence
 	//OSCTUN = -5;						//change osctun: 12.5% / 32
+#if defined(NV_USED)
+	OSCTUN = nv.trim;					//change osctun: trim from the last run
+#endif
 	//SYSKEY = 0x33333333ul;				//lock by writing any non critical value
 	
+#if defined(EXTCLK_USED)
+	EXTCLK_PIN();						//external clock into T2CK
+#endif
 	tmr2_init();						//reset tmr2
 	//configure the input capture pin ICP1
 	PPS_PIN();
 	ic1_init();							//reset ic1
-	//wait for the first capture event
-	while (ICxIF == 0) continue;
-	tick0 = ICxBUF;						//read the first capture
-	ICxIF = 0;							//clear the flag after having read the buffer - flag is persistent so the read order has to be maintained
+	tmr1_init();						//reset tmr1, for the watchdog
+	//don't wait for the first capture: the isr starts the gate on it
+	freqc_state = FREQC_WAIT;			//waiting for the first 1pps pulse
 	ICxIE = 1;							//enable the interrupt
 }
 	
+#if defined(TC_USED)
+//read the temperature, 16x oversampled
+void temp_read(void) {
+	uint8_t i;
+
+	for (temp = 0, i = 0; i < 16; i++) temp += adc1_read(TEMP_AN);
+}
+
+//report the temperature and the frequency the model predicts at it
+//with or without the 1pps: without it, the prediction stands in for the measurement
+void tc_report(void) {
+	uint32_t tmp;
+
+	freq_i = tc_freq(&tc, temp, &tc_frac);
+	tmp = (uint32_t) temp * TEMP_MV_REF / 16384;	//sensor output, mv = 0.1C above TEMP_MV_0C
+	if (tmp < TEMP_MV_0C) sprintf(uRAM, "temp = -%3ld.%ldC, ", (TEMP_MV_0C - tmp) / 10, (TEMP_MV_0C - tmp) % 10);
+	else sprintf(uRAM, "temp = +%3ld.%ldC, ", (tmp - TEMP_MV_0C) / 10, (tmp - TEMP_MV_0C) % 10);
+	sprintf(uRAM + 16, "tc = %10ld.%03dHz.\n\r", freq_i, (int) (((uint64_t) tc_frac * 1000) >> 32));
+	uart1_puts(uRAM);
+}
+#endif
+
 int main(void) {
 	uint32_t tmp;
+	cap_t cap;							//current capture record
+	uint16_t ovf = 0;					//cap_ovf last reported
+#if defined(ISR_STATS)
+	uint16_t lat = 0, dur = 0;			//isr_lat / isr_dur last reported
+#endif
 	
 	mcu_init();							//reset the mcu
 	IO_SET(LED_PORT, LED); IO_OUT(LED_DDR, LED);				//led as output
-	freqc_init();						//reset the frequency calibrator
+	freqc_init();						//reset the frequency calibrator - returns without waiting for the 1pps
 	uart1_init(9600);					//reset uart
 	ei();								//enable global interrupts
 	while (1) {
-		if (freq_available) {			//new data has arrived
-			freq_available = 0;			//data has been read, no new data now
+		while (cap_tail != cap_head) {	//new data has arrived: process every record in the ring
+			cap = cap_buf[cap_tail % CAP_N];	//copy the record out, then free its slot
+			cap_tail += 1;
+#if defined(ISR_DEFER)
+			if (freqc_gate(&cap) == 0) continue;	//not the end of a gate yet
+#endif
+			freq = cap.ticks;			//frequency measurement
 			
 			//smoothing the reading
+#if defined(KF_USED)
+			if (kf.n == 0) kf_init(&kf, freq);	//first reading seeds the filter
+			else kf_update(&kf, freq);
+			freq_avg = kf_freq(&kf, &kf_frac);
+			freq_f   = ((uint64_t) kf_frac * FREQ_CNT) >> 32;	//fractional frequency, in 1/FREQ_CNT
+#else
 			freq_sum += freq - freq_avg;
 			freq_avg = freq_sum / FREQ_CNT;
 			//freq_i   = freq_sum / FREQ_CNT;
 			//calculate the fractional frequency
 			freq_f   = freq_sum - freq_avg * FREQ_CNT;
+#endif
+#if defined(NV_USED)
+			//save the calibration - rarely, for flash endurance
+			if (--nv_cnt == 0) {
+				nv_cnt = NV_EVERY;
+#if defined(KF_USED)
+				nv.freq = kf_freq(&kf, &nv.frac);
+				nv.drift = kf.x[2];			//|drift| < 1/2 tick per gate^2
+#else
+				nv.freq = freq_avg;
+				nv.frac = ((uint64_t) freq_f << 32) / FREQ_CNT;
+				nv.drift = 0;
+#endif
+				nv.trim = OSCTUN;
+				nv_write(&nv);
+			}
+#endif
+#if defined(TC_USED)
+			//read the temperature and learn the raw reading at it - the bins do the averaging
+			temp_read();
+			tc_learn(&tc, temp, freq, 0);
+#endif
 			
 			//convert freq for transmission
 			tmp = freq;					//display freq
@@ -215,12 +471,43 @@ int main(void) {
 			//sprintf(uRAM, "freq_error = %8dHz.\n\r", freq_error);
 			//sprintf(uRAM, "freq = %10ldHz.\n\r", freq);
 			//sprintf(uRAM, "freq_sum=%10ld, freq_i=%10ld, freq_f=%10ld\n\r", freq_sum, freq_i, freq_f);
+#if defined(KF_USED)
+			tmp = ((uint64_t) kf_sigma(&kf) * 1000000000ul / freq_avg) >> 16;	//1-sigma uncertainty, ppb
+			sprintf(uRAM, "freq = %10ldHz, freq = %10ld.%03dHz, +/-%5ldppb.\n\r", freq, freq_avg, (int) (((uint64_t) kf_frac * 1000) >> 32), tmp);
+#else
 			sprintf(uRAM, "freq = %10ldHz, freq = %10ld.%03dHz.\n\r", freq, freq_avg, (int) freq_f * 1000 / FREQ_CNT);
+#endif
 #endif
 			uart1_puts(uRAM);			//start transmission
+#if defined(TC_USED)
+			tc_report();				//frequency predicted by the model at the current temperature
+#endif
 
 			//IO_FLP(LED_PORT, LED);		//flip the led
 		}	
+		if (cap_ovf != ovf) {			//records were dropped: report it
+			ovf = cap_ovf;
+			sprintf(uRAM, "overflow = %u records.\n\r", ovf);
+			uart1_puts(uRAM);
+		}
+#if defined(ISR_STATS)
+		if (isr_lat != lat || isr_dur != dur) {	//new worst case: report it
+			lat = isr_lat; dur = isr_dur;
+			sprintf(uRAM, "isr: latency <= %u, duration <= %u ticks.\n\r", lat, dur);
+			uart1_puts(uRAM);
+		}
+#endif
+		//1pps watchdog: report when it's missing, re-acquire when it comes back
+		if (pps_seen) {pps_seen = 0; pps_time = CT_GET();}
+		else if ((uint16_t) (CT_GET() - pps_time) > PPS_TIMEOUT * CT_TICKS) {
+			pps_time = CT_GET();		//report once every PPS_TIMEOUT
+			freqc_state = FREQC_WAIT;	//the next pulse restarts the gate
+			uart1_puts("waiting for PPS...\n\r");
+#if defined(TC_USED)
+			//no 1pps: report the frequency the model predicts at the current temperature
+			if (tc.f0) {temp_read(); tc_report();}
+#endif
+		}
 		//delay_ms(100);
 		//uart1_puts("testing...\n\r");
     }
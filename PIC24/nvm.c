@@ -0,0 +1,60 @@
+//source file for the nonvolatile calibration record on PIC24 flash, via rtsp
+
+#include "nvm.h"						//we use nvm
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+#define NVM_WORD			0x4003		//program one word
+#define NVM_ERASE			0x4042		//erase one page
+
+//global variables
+//reserved flash page, page aligned so erasing it doesn't touch the code
+static const uint16_t nv_flash[_FLASH_PAGE] __attribute__((space(prog), aligned(_FLASH_PAGE * 2))) = {0xffff};
+
+//checksum: fletcher-16, keyed
+static uint16_t nv_chk(const uint8_t *p, uint8_t n) {
+	uint16_t s1 = 0, s2 = 0;
+
+	while (n--) {s1 = (s1 + *p++) % 255; s2 = (s2 + s1) % 255;}
+	return ((s2 << 8) | s1) ^ NV_KEY;
+}
+
+//run one nvm operation on the latched address / data
+//return WRERR
+static uint16_t nvm_op(uint16_t op) {
+	NVMCON = op;						//1->enable writes, operation
+	__builtin_write_NVM();				//unlock sequence + start, with interrupts disabled
+	while (NVMCONbits.WR) continue;		//wait for the operation to finish
+	return NVMCONbits.WRERR;
+}
+
+//read the calibration record
+int8_t nv_read(nv_t *nv) {
+	uint16_t *p = (uint16_t *) nv;
+	uint16_t i, off;
+
+	TBLPAG = __builtin_tblpage(nv_flash);
+	off = __builtin_tbloffset(nv_flash);
+	for (i = 0; i < sizeof(nv_t) / 2; i++, off += 2) p[i] = __builtin_tblrdl(off);
+	return (nv->chk == nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk))) ? 0 : -1;
+}
+
+//write the calibration record
+int8_t nv_write(nv_t *nv) {
+	const uint16_t *p = (const uint16_t *) nv;
+	uint16_t i, off;
+
+	nv->chk = nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk));
+	TBLPAG = __builtin_tblpage(nv_flash);
+	off = __builtin_tbloffset(nv_flash);
+	__builtin_tblwtl(off, 0);			//erase the page: any write latches the address
+	if (nvm_op(NVM_ERASE)) return -1;
+	for (i = 0; i < sizeof(nv_t) / 2; i++, off += 2) {	//then program it, one word at a time
+		__builtin_tblwtl(off, p[i]);
+		__builtin_tblwth(off, 0xff);	//upper byte unused
+		if (nvm_op(NVM_WORD)) return -1;
+	}
+	return 0;
+}
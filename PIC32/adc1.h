@@ -0,0 +1,24 @@
+#ifndef ADC1_H_INCLUDED
+#define ADC1_H_INCLUDED
+
+#include "gpio.h"
+
+//hardware configuration
+#define ADC1_SAMC				31					//auto sample time, in tad, 1..31
+#define ADC1_ADCS				7					//tad = 2 * (ADC1_ADCS + 1) tpb. 7 -> 800ns at 20Mhz pbclk
+//end hardware configuration
+
+//global defines
+
+//global variables
+
+//reset adc1
+//10-bit, integer output, avdd/avss as references, manual sampling, auto conversion
+//the analog pins are configured by the caller (tris / ansel)
+void adc1_init(void);
+
+//read an analog channel, blocking
+//ch: 0..15 -> AN0..AN15
+uint16_t adc1_read(uint8_t ch);
+
+#endif /* ADC1_H_INCLUDED */
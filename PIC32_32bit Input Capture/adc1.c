@@ -0,0 +1,40 @@
+//source file for adc1 for PIC32
+
+#include "adc1.h"						//we use adc
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+
+//global variables
+
+//reset adc1
+void adc1_init(void) {
+	PMD1bits.AD1MD = 0;					//0->enable power to adc
+	AD1CON1 = 0;						//turn off the adc
+	AD1CON1 = 	(0<< 8) |				//0->16-bit integer output
+				(7<< 5) |				//7->auto conversion after the sample time
+				(0<< 2) |				//0->sampling starts when SAMP is set, 1->sampling starts after the last conversion
+				0x00;
+	AD1CON2 = 	(0<<13) |				//0->avdd/avss as references
+				(0<<10) |				//0->no scanning
+				(0<< 2) |				//0->interrupt after every conversion
+				0x00;
+	AD1CON3 = 	(0<<15) |				//0->adc clock from pbclk, 1->from the internal rc
+				(ADC1_SAMC<< 8) |		//auto sample time, tad
+				(ADC1_ADCS<< 0) |		//adc clock divider
+				0x00;
+	AD1CSSL = 0;						//no channels scanned
+	//turn on the adc
+	AD1CON1 |= (1<<15);					//1->turn on the adc, 0->turn off the adc
+}
+
+//read an analog channel
+uint16_t adc1_read(uint8_t ch) {
+	AD1CHS = (uint32_t) (ch & 0x0f) << 16;	//positive input: ch, negative input: avss
+	AD1CON1bits.DONE = 0;				//clear the flag
+	AD1CON1bits.SAMP = 1;				//start sampling. conversion starts after ADC1_SAMC
+	while (AD1CON1bits.DONE == 0) continue;	//wait for the conversion to finish
+	return ADC1BUF0;
+}
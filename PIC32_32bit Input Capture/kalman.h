@@ -0,0 +1,57 @@
+#ifndef KALMAN_H_INCLUDED
+#define KALMAN_H_INCLUDED
+
+#include <stdint.h>						//we use int64_t
+
+//fixed point: Q31.32 in an int64_t
+#define KF_Q32(x)				((int64_t) ((x) * 4294967296.0))
+
+//filter configuration, in units of the interval fed to kf_update() (ticks per gate)
+#define KF_R					KF_Q32(2.0)			//measurement noise: capture quantization + 1pps jitter, ticks^2
+#define KF_Q0					KF_Q32(0.0)			//process noise, phase, ticks^2 per gate
+#define KF_Q1					KF_Q32(0.0002)		//process noise, frequency, (ticks/gate)^2 per gate
+#define KF_Q2					KF_Q32(0.0000001)	//process noise, drift, (ticks/gate^2)^2 per gate
+#define KF_P1					KF_Q32(4.0)			//initial frequency variance when seeded from a stored estimate, (ticks/gate)^2
+#define KF_P2					KF_Q32(0.0001)		//initial drift variance, (ticks/gate^2)^2
+#define KF_MISS					8					//max. number of missed gates bridged before a reset
+//end filter configuration
+
+//global defines
+
+//three-state kalman filter: phase, frequency offset, drift
+//all in Q31.32, relative to the nominal interval n
+typedef struct {
+	int64_t x[3];						//state: phase (ticks), frequency offset (ticks/gate), drift (ticks/gate^2)
+	int64_t p[6];						//covariance, upper triangle: p00 p01 p02 p11 p12 p22
+	int64_t q[3];						//process noise: phase, frequency, drift
+	int64_t r;							//measurement noise
+	int64_t z;							//measured phase
+	int32_t n;							//nominal interval, ticks per gate
+} kf_t;
+
+//global variables
+
+//reset the filter
+//n: nominal interval, typically the first measured interval
+//process / measurement noise are set to KF_Qx / KF_R, and can be changed in kf->q[] / kf->r afterwards
+void kf_init(kf_t *kf, int32_t n);
+
+//process one measured interval, ticks per gate
+//missed 1pps pulses are bridged; return 0 if accepted, -1 if the filter had to be reset
+int kf_update(kf_t *kf, int32_t ticks);
+
+//reset the filter from a stored estimate, e.g. saved before the last reset
+//n, frac: interval as returned by kf_freq(), drift: kf->x[2]. the frequency starts with KF_P1 variance
+void kf_seed(kf_t *kf, int32_t n, uint32_t frac, int64_t drift);
+
+//filtered interval: integer ticks per gate, *frac = fractional part, Q0.32
+int32_t kf_freq(kf_t *kf, uint32_t *frac);
+
+//1-sigma uncertainty of kf_freq(), Q16.16 ticks per gate
+uint32_t kf_sigma(kf_t *kf);
+
+//convert the filter to a gate twice as long (up = 1) or half as long (up = 0)
+//state and covariance are converted exactly, the process noise as random walks scale
+void kf_scale(kf_t *kf, uint8_t up);
+
+#endif /* KALMAN_H_INCLUDED */
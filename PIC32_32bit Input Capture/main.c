@@ -10,14 +10,27 @@
 //v0.4: 4/27/2018 - ported to PIC32MX
 //v0.5: 4/28/2018 - numerous minor improvements
 //v0.6: 4/29/2018 - ported to a 32-bit input capture - can be used as a frequency calibrator or a frequency meter
+//v0.7: 10/18/2026 - fixed-point kalman filter (phase, frequency, drift) as an alternative to the FREQ_CNT average
+//v0.8: 10/18/2026 - temperature compensation: frequency vs. temperature learned online from an adc sensor
+//v0.9: 10/18/2026 - calibration saved to flash and used to seed the filter on the next reset
+//v1.0: 10/18/2026 - non-blocking start: the isr acquires the first 1pps pulse, a watchdog reports when it's missing
+//v1.1: 10/18/2026 - captures passed to main through a ring, with an overflow count, instead of a single variable
+//v1.2: 10/18/2026 - optional deferred isr (raw captures queued, gate arithmetic in main), isr latency / duration measured
+//v1.3: 10/18/2026 - optional external clock: the capture timebase counts an external oscillator on T2CK, to measure it
+//v1.4: 10/18/2026 - optional auto-ranging gate: the shortest gate whose observed stability meets a target, readings tagged with it
+//v1.5: 10/18/2026 - optional time of day for the application, disciplined by the 1pps: todclk_get()
+//v1.6: 10/18/2026 - optional time interval counter: phase of the 1pps against a local 1pps, in ns, unwrapped
+//v1.7: 10/18/2026 - optional utc from the gps' nmea (RMC / ZDA) on U1RX: readings tagged with the utc second of their 1pps
+//v1.8: 10/18/2026 - optional self-test: OC4 pulses off the 32-bit timebase drive the capture pin, capture rate swept, gates checked, no 1pps needed
 //
 //Connections:
 //
 //                              |---------------------|
 //      1PPS generator -------->|ICP1/RA4             |
-//                              |                     |
-//                              |                     |
-//                              |                     |
+//  MCP9700 (optional) -------->|AN0/RA0              |
+//ext. osc. (optional) -------->|T2CK/RB4             |
+//    local 1pps (TIC) <--------|OC3/IC2/RB14         |
+//      gps nmea (optional) --->|U1RX/RB13            |
 //                              |                     |
 //                              |                     |
 //                              |                     |
@@ -42,13 +55,53 @@
 #include "delay.h"						//we use software delays
 #include "uart1.h"						//we use uart
 #include "pwm4.h"						//we use pwm
+#include "kalman.h"						//we use kalman filter
+#include "adc1.h"						//we use adc
+#include "tempco.h"						//we use temperature compensation
+#include "nvm.h"						//we use nonvolatile memory
+#include "todclk.h"						//we use time of day
+#include "nmea.h"						//we use nmea parser
 
 //hardware configuration
 //#define F_CLK       F_PHB				//clock of oscillator to be calibrated
-#define PPS_CNT		2					//number of 1pps pulses to count
+//#define EXTCLK_USED					//the capture timebase counts an external oscillator on T2CK, instead of the pbclk. uncomment to use
+#define EXTCLK_PIN()	do {PPS_T2CK_TO_RPB4(); IO_IN(TRISB, 1<<4);} while (0)	//T2CK on RB4, as input - RB3 is U1TX: A0/B3/B4/B15/B7/C7/C0/C5
+#define PPS_CNT		2					//number of 1pps pulses to count. the first gate with AR_USED, a power of 2
+//#define AR_USED						//auto-ranging: the gate is doubled / halved to the shortest one that meets AR_PPB. uncomment to use
+#define AR_PPB		10					//requested resolution, ppb: gate-to-gate deviation of the readings
+#define AR_MAX		32					//longest gate, 1pps pulses, a power of 2. (AR_MAX << PBDIV) x F_PHB < 2^31, x FREQ_CNT without KF_USED
+#define AR_N		32					//gates observed between decisions. the last 4 x AR_N gates are used
 #define IC1_PIN()	PPS_IC1_TO_RPA4()	//1pps input pin assignment: A2/B6/A4/B13/B2/C6/C1/A3
 #define FREQ_CNT	10					//weight used in smoothing algorithm
 #define SET_PBDIV	2					//current setting of PBDIV, 1/2/4/8 (default)
+#define OSCTUN_DEF	(-5)				//default FRC trim, OSCTUN
+#define KF_USED							//smoothing by the kalman filter. comment out to use the FREQ_CNT average
+//#define TC_USED						//temperature compensation. uncomment to use
+#define TEMP_AN		0					//temperature sensor on AN0
+#define TEMP_PIN()	do {IO_IN(TRISA, 1<<0); ANSELA |= (1<<0);} while (0)	//AN0/RA0 as analog input
+#define TEMP_MV_REF	3300				//adc reference, mv
+#define TEMP_MV_0C	500					//sensor output at 0C, mv. sensor slope assumed to be 10mv/C
+#define NV_USED							//calibration saved to flash, to seed the filter on the next reset. comment out to disable
+#define NV_FIRST	600					//first save, gates after reset - the filter has settled by then
+#define NV_EVERY	86400ul				//then one save every NV_EVERY gates - flash endurance is ~20k cycles
+
+#define PPS_TIMEOUT	2					//seconds without a 1pps pulse before it's reported missing and re-acquired
+//#define TOD_USED						//time of day kept from the 1pps and the measured timebase rate, see todclk.h. uncomment to use
+//#define TIC_USED						//time interval counter: the 1pps minus a local 1pps, in ns, reported every second. uncomment to use
+#define TIC_PIN()	do {PPS_OC3_TO_RPB14(); PPS_IC2_TO_RPB14(); IO_OUT(TRISB, 1<<14); ANSELB &=~(1<<14);} while (0)	//local 1pps out of OC3, read back by IC2 on the same pin: A3/B14/B0/B10/B9/C9/C2/C4
+#define TIC_PW		10					//local 1pps pulse width, 1/TIC_PW s
+#define TIC_TPS_EXT	10000000ul			//local 1pps period with EXTCLK_USED, timebase ticks: the external clock's nominal frequency
+//#define NMEA_USED						//utc from the nmea of the gps the 1pps comes from, at the uart's baud rate: readings tagged with it. uncomment to use
+#define NMEA_PIN()	do {PPS_U1RX_TO_RPB13(); IO_IN(TRISB, 1<<13); ANSELB &=~(1<<13);} while (0)	//U1RX on RB13, as digital input: A2/B6/A4/B13/B2/C6/C1/A3
+//#define ISR_DEFER						//the isr only queues the raw capture, the gate arithmetic runs in main. uncomment to use
+//#define ISR_STATS						//worst-case isr latency / duration measured and reported. uncomment to use
+//isr cost at a gate's end, counted off the code at -O1 with the defaults (estimates - ISR_STATS measures them on the part), sysclk:
+//  in-isr gate: ~50 + ~34 context save / restore. ISR_DEFER: ~28 + ~30. latency, edge to the first line: ~25 in both
+//  TOD_USED calls todclk_edge() from the isr: ~+40 and the full caller-saved context, in either mode
+//#define SELFTEST_USED					//self-test: OC4 (also on RA4) drives the capture in place of the 1pps - disconnect it. uncomment to use
+#define ST_PR_MAX	30000				//self-test: slowest pulse period, TMRx ticks - the sweep starts there
+#define ST_PR_MIN	40					//self-test: fastest pulse period, TMRx ticks - the sweep stops there
+#define ST_MS		1000				//self-test: measurement window, ms
 
 #define LED_PORT	LATB
 #define LED_DDR		TRISB
@@ -56,6 +109,46 @@
 //end hardware configuration
 
 //global defines
+#if defined(EXTCLK_USED)
+#define TxTCS		1					//timebase clock: 1->external, T2CK. any frequency up to the T2CK input limit, no nominal needed
+#else
+#define TxTCS		0					//timebase clock: 0->internal, pbclk
+#endif
+#if defined(SELFTEST_USED) && defined(EXTCLK_USED)
+#error "the self-test needs the pbclk as the capture timebase: no EXTCLK_USED"
+#endif
+#if defined(SELFTEST_USED)
+#define ISR_STATS						//the self-test reports the isr timing
+#endif
+#define FREQC_WAIT	0					//acquisition state: waiting for the first 1pps pulse
+#define FREQC_RUN	1					//acquisition state: gating
+#define CAP_N		8					//capture ring size, a power of 2
+#define CAP_FIRST	(1<<0)				//capture flag: first gate after (re)acquisition
+#define CAP_OVF		(1<<1)				//capture flag: records were dropped just before this one
+//capture record, from the isr to main
+typedef struct {
+	uint32_t tick;						//capture at the end of the gate
+	 int32_t ticks;						//ticks in the gate
+	 uint8_t gate;						//1pps pulses in the gate
+#if defined(NMEA_USED)
+	uint32_t pps;						//number of the 1pps edge at the end of the gate, pps_num
+#endif
+	 uint8_t flags;						//CAP_xxx
+} cap_t;
+#if defined(AR_USED)
+#define GATE_NEXT()	pps_gate			//length of the next gate: picked by main
+#else
+#define GATE_NEXT()	PPS_CNT				//length of the next gate: fixed
+#endif
+#if defined(ISR_STATS)
+#define ISR_ENTER()	uint16_t isr_t0 = TMRx	//timebase on entry, after the compiler's context save
+#define ISR_EXIT()	do {if ((uint16_t) (isr_t0 - tick1) > isr_lat) isr_lat = isr_t0 - tick1; if ((uint16_t) (TMRx - isr_t0) > isr_dur) isr_dur = TMRx - isr_t0;} while (0)
+#else
+#define ISR_ENTER()
+#define ISR_EXIT()
+#endif
+#define CT_GET()	_CP0_GET_COUNT()	//coarse timebase for the 1pps watchdog: core timer
+#define CT_TICKS	(F_CPU / 2)			//core timer ticks per second
 //LSW of the 32-bit time base
 #define TxMD		PMD4bits.T2MD
 #define TxCON		T2CON
@@ -74,34 +167,209 @@
 #define ICxIP		IPC1bits.IC1IP
 #define ICxBUF		IC1BUF
 
+//local 1pps for the time interval counter
+#define OCxMD		PMD3bits.OC3MD
+#define OCxCON		OC3CON
+#define OCxR		OC3R
+#define OCxRS		OC3RS
+#define OCxIF		IFS0bits.OC3IF
+#define OCxIE		IEC0bits.OC3IE
+#define OCxIP		IPC3bits.OC3IP
+//its capture
+#define ICyMD		PMD3bits.IC2MD
+#define ICyCON		IC2CON
+#define ICyIF		IFS0bits.IC2IF
+#define ICyIE		IEC0bits.IC2IE
+#define ICyIP		IPC2bits.IC2IP
+#define ICyBUF		IC2BUF
+
+//self-test pulses
+#define OCzMD		PMD3bits.OC4MD
+#define OCzCON		OC4CON
+#define OCzR		OC4R
+#define OCzRS		OC4RS
+#define OCzIF		IFS0bits.OC4IF
+#define OCzIE		IEC0bits.OC4IE
+#define OCzIP		IPC4bits.OC4IP
+
 //global variables
 volatile uint32_t tick0, tick1;			//32-bit captures
 volatile  int32_t freq_error;			//frequency error
 volatile uint32_t freq;					//frequency measurement
-volatile  uint8_t freq_available=0;		//1->new data available
+volatile   cap_t cap_buf[CAP_N];		//capture ring, single producer (isr) / single consumer (main)
+volatile  uint8_t cap_head=0;			//next slot to be written, by the isr only
+volatile  uint8_t cap_tail=0;			//next slot to be read, by main only
+volatile uint16_t cap_ovf=0;			//records dropped because the ring was full, written by the isr only
+volatile  uint8_t cap_flags=0;			//flags for the next record, isr only
+uint8_t pbdiv;							//OSCCONbits.PBDIV, cached by freqc_init() - an sfr read is slow
+#if defined(ISR_DEFER)
+uint8_t gate_flags=0;					//flags for the next gate, main only
+uint32_t gate_tick0;					//start of the gate, main only - tick0 / tick1 belong to the isr
+#endif
+#if defined(ISR_STATS)
+volatile uint16_t isr_lat=0, isr_dur=0;	//worst-case isr latency (edge to entry) / duration (entry to exit), TMRx ticks
+#endif
 volatile  uint8_t pps_cnt = PPS_CNT;	//current 1pps pulse count, downcounter
+volatile  uint8_t pps_len = PPS_CNT;	//1pps pulses in the current gate
+#if defined(AR_USED)
+volatile  uint8_t pps_gate = PPS_CNT;	//1pps pulses in the next gate, written by main only
+uint8_t gate = PPS_CNT;					//gate the filter / average are in, main only
+uint8_t ar_cnt;							//differences observed at this gate, 0->none yet
+int32_t ar_prev;						//previous reading
+uint64_t ar_sum;						//sum of the squared reading-to-reading differences
+#endif
+volatile  uint8_t freqc_state = FREQC_WAIT;	//acquisition state
+volatile  uint8_t pps_seen = 0;		//1->a 1pps pulse has arrived, cleared by the watchdog in main
+#if defined(NMEA_USED)
+volatile uint32_t pps_num=0;			//1pps edges so far, by the isr only
+nmea_t nmea;							//nmea parser, fed by the uart rx isr
+volatile uint32_t nmea_pps;				//pps_num when the last good sentence ended: its time is that edge's
+volatile  uint8_t nmea_seq=0;			//bumped by the isr on each good sentence
+int64_t utc_off;						//utc second of 1pps edge n = n + utc_off, main only
+uint8_t utc_ok=0;						//0->no utc yet
+#endif
+#if defined(TIC_USED)
+uint32_t tic_tps;						//local 1pps period, timebase ticks, cached by tic_init()
+volatile uint32_t tic_ref, tic_loc;		//last 1pps / local 1pps captures
+volatile  uint8_t tic_rseq=0, tic_lseq=0;	//bumped by the isrs on each of them
+int32_t tic_prev;						//last phase, -1/2s..+1/2s, ticks
+int64_t tic_phase;						//unwrapped phase, ticks
+uint8_t tic_ok=0;						//0->no phase yet
+#endif
+#if defined(SELFTEST_USED)
+volatile uint32_t st_pr;				//self-test: current pulse period, TMRx ticks
+#endif
+uint32_t pps_time;						//time of the last 1pps pulse, CT_GET()
 		  int32_t freq_sum, freq_avg, freq_i, freq_f;
+#if defined(KF_USED)
+kf_t kf;								//kalman filter, kf.n = 0 -> not yet seeded
+uint32_t kf_frac;						//fractional part of the filtered frequency
+#endif
+#if defined(TC_USED)
+tc_t tc;								//frequency vs. temperature model
+uint16_t temp;							//temperature, 16x oversampled adc reading
+uint32_t tc_frac;						//fractional part of the predicted frequency
+const char str1[]="temp = +  0.0C, tc =          .000Hz.\n\r";
+#endif
+#if defined(NV_USED)
+nv_t nv;								//calibration record
+uint32_t nv_cnt;						//gates to the next save, downcounter
+#endif
 char uRAM[80];							//transmitt buffer for uart
+#if defined(KF_USED) && defined(AR_USED)
+const char str0[]="freq =          .000Hz, +/-    0ppb, gate   1s.\n\r";
+#elif defined(KF_USED)
+const char str0[]="freq =          .000Hz, +/-    0ppb.\n\r";
+#elif defined(AR_USED)
+const char str0[]="freq =          .000Hz, gate   1s.\n\r";
+#else
 const char str0[]="freq =          .000Hz.\n\r";
+#endif
 
 //input capture ISR
 void __ISR(_INPUT_CAPTURE_1_VECTOR/*, ipl7*/) _IC1Interrupt(void) {
+	ISR_ENTER();						//for isr statistics
 	//clear the flag
 	tick1 = ICxBUF;						//read the capture buffer first
 	ICxIF = 0;							//clear the flag after the buffer has been read (the interrupt flag is persistent)
+	pps_seen = 1;						//for the watchdog
+#if defined(TIC_USED)
+	tic_ref = tick1; tic_rseq += 1;		//every edge, for the phase
+#endif
+#if defined(NMEA_USED)
+	pps_num += 1;						//every edge, for its utc
+#endif
+#if defined(TOD_USED)
+	todclk_edge(tick1);					//every edge, whatever the gate
+#endif
+#if defined(ISR_DEFER)
+	//queue the raw capture: the gate is worked out in main, by freqc_gate()
+	if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the capture
+		cap_buf[cap_head % CAP_N].tick  = tick1;
+		cap_buf[cap_head % CAP_N].flags = cap_flags;
+#if defined(NMEA_USED)
+		cap_buf[cap_head % CAP_N].pps   = pps_num;
+#endif
+		cap_flags = 0;
+		cap_head += 1;					//publish the record, after it has been written
+	} else {							//ring full: drop the capture
+		cap_ovf += 1;
+		cap_flags |= CAP_OVF;
+	}
+	ISR_EXIT();
+	return;
+#endif
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start the gate on it
+		tick0 = tick1;
+		pps_cnt = pps_len = GATE_NEXT();
+		freqc_state = FREQC_RUN;
+		cap_flags |= CAP_FIRST;
+		ISR_EXIT();
+		return;
+	}
 	pps_cnt -= 1;						//decrement pps_cnt
 	if (pps_cnt == 0) {
-		pps_cnt = PPS_CNT;				//reset pps_cnt
+		pps_cnt = GATE_NEXT();			//reset pps_cnt, to the length of the next gate
 		//freq_error = tick1 - (tick0 + F_CLK * PPS_CNT); freq = F_CLK * PPS_CNT + freq_error; 
-		freq = tick1 - tick0;			//calculate the frequency - 32-bit capture means no need to know F_CLK
-		freq = freq << OSCCONbits.PBDIV;	//correct for PBDIV
 		//sprintf(uRAM, "tick0 = %12ld, tick1 = %12ld.\n\r", TMRx, TMRy);
 		//uart1_puts(uRAM);
+		if ((uint8_t) (cap_head - cap_tail) < CAP_N) {	//room in the ring: push the record
+			cap_buf[cap_head % CAP_N].tick  = tick1;
+			cap_buf[cap_head % CAP_N].ticks = (tick1 - tick0) << pbdiv;	//32-bit capture means no need to know F_CLK. correct for PBDIV
+			cap_buf[cap_head % CAP_N].gate  = pps_len;
+			cap_buf[cap_head % CAP_N].flags = cap_flags;
+#if defined(NMEA_USED)
+			cap_buf[cap_head % CAP_N].pps   = pps_num;
+#endif
+			cap_flags = 0;
+			cap_head += 1;				//publish the record, after it has been written
+		} else {						//ring full: drop the record
+			cap_ovf += 1;
+			cap_flags |= CAP_OVF;
+		}
 		tick0 = tick1;					//update tick0
-		freq_available = 1;				//new data available
+		pps_len = pps_cnt;
 		IO_FLP(LED_PORT, LED);			//flip led
 	}
+	ISR_EXIT();
+}
+
+#if defined(TIC_USED)
+//local 1pps, falling edge: the next pulse, a second on
+void __ISR(_OUTPUT_COMPARE_3_VECTOR) _OC3Interrupt(void) {
+	OCxIF = 0;							//clear the flag
+	OCxR  += tic_tps;					//rising edge
+	OCxRS += tic_tps;					//falling edge
+}
+
+//local 1pps, rising edge, as captured off the pin
+void __ISR(_INPUT_CAPTURE_2_VECTOR) _IC2Interrupt(void) {
+	tic_loc = ICyBUF;					//read the capture buffer first
+	ICyIF = 0;							//clear the flag after the buffer has been read
+	tic_lseq += 1;
+}
+#endif
+
+#if defined(SELFTEST_USED)
+//self-test pulses, falling edge: the next pulse, a period on
+//at a higher priority than the capture, so the pulses keep coming whatever the isr under test does
+void __ISR(_OUTPUT_COMPARE_4_VECTOR) _OC4Interrupt(void) {
+	OCzIF = 0;							//clear the flag
+	OCzR  += st_pr;						//rising edge
+	OCzRS += st_pr;						//falling edge
+}
+#endif
+
+#if defined(NMEA_USED)
+//uart rx: the gps' nmea, parsed as it comes in
+//a good sentence is the time of the 1pps edge it follows: the last one seen
+void __ISR(_UART_1_VECTOR) _UART1Interrupt(void) {
+	while (U1STAbits.URXDA)				//empty the fifo
+		if (nmea_put(&nmea, U1RXREG)) {nmea_pps = pps_num; nmea_seq += 1;}
+	if (U1STAbits.OERR) U1STAbits.OERR = 0;	//overrun: clear it, the parser drops the broken sentence
+	IFS1bits.U1RXIF = 0;				//clear the flag after the fifo has been emptied
 }
+#endif
 	
 //reset timer2/3 as 32-bit timebase for input capture
 //free running, 32-bit
@@ -120,7 +388,7 @@ void tmr23_init(void) {
 				(0<< 7) |				//1->gating enabled, 0->gating disabled
 				(0<< 4) |				//0->1:1 prescaler, 1->2x prescaler, 2->4x prescaler, 3->8x prescaler, ..., 7->256x prescaler
 				(1<< 3) |				//0->16 bit mode, 1->32-bit mode
-				(1<< 0) |				//0->count on internal clock, 1->count on external clock
+				(TxTCS<< 1) |			//0->count on internal clock, 1->count on external clock
 				0x00;
 	//TMRx = 0;							//reset the counter - optional
 	PRx  = /*PRy = */-1;				//period = 0xffff
@@ -160,20 +428,143 @@ void ic1_init(void) {
 	ICxCON |= (1<<15);					//1->enable the module, 0->disable the module
 	//input capture running now
 }
+
+#if defined(TIC_USED)
+//reset the time interval counter
+//OC3 puts out a local 1pps off the timebase, every tic_tps ticks: 32-bit dual compare, high at OCxR,
+//low at OCxRS. IC2 captures it back off the pin, the way IC1 captures the 1pps - the two see the
+//same input delay, and it drops out of their difference
+void tic_init(void) {
+#if defined(EXTCLK_USED)
+	tic_tps = TIC_TPS_EXT;
+#else
+	tic_tps = F_PHB;					//cached: F_PHB reads an sfr
+#endif
+	tic_ok = 0;							//no phase yet
+	TIC_PIN();							//OC3 out / IC2 in, on the same pin
+	
+	//local 1pps
+	OCxMD = 0;							//0->enable power to output compare
+	OCxCON  =	(0<<15) |				//1->enable the module, 0->disable the module
+				(0<<13) |				//0->operates in idle, 1->don't operate in idle
+				(1<< 5) |				//1->32-bit compare, 0->16-bit compare
+				(0<< 3) |				//0->timer2 as timebase, 1->timer3 as timebase
+				(5<< 0) |				//5->dual compare, continuous pulses. interrupt on the falling edge
+				0x00;
+	OCxR  = TMRx + tic_tps;				//first pulse a second from now
+	OCxRS = OCxR + tic_tps / TIC_PW;
+	
+	//its capture: as ic1_init()
+	ICyMD = 0;							//0->enable power to input capture
+	ICyCON  = 	(0<<15) |				//1->enable the module, 0->disable the module
+				(1<<8) |				//1->32-bit mode, 0->16-bit mode
+				(1<<7) |				//1->timer2 as timebase, 0->timer3 as timebase
+				(3<<0) |				//3->every rising edge
+				0x00;
+	
+	OCxIF = ICyIF = 0;					//0->clear the flag
+	OCxIP = ICyIP = 1;
+	OCxIE = ICyIE = 1;					//1->enable the interrupt
+	ICyCON |= (1<<15);					//capture first, then the pulses
+	OCxCON |= (1<<15);
+}
+
+//time interval counter: a 1pps capture against a local one, d = tic_ref - tic_loc
+//the local edges are tic_tps apart: d modulo tic_tps is the phase, whichever local edge it's taken
+//against. unwrapped: the change from the last reading is taken as the shorter way round, within
+//1/2s, and added up - the phase carries on through the +/-1/2s boundary. return it, ns
+int64_t tic_update(int32_t d) {
+	int32_t half = tic_tps / 2, dd;
 	
+	d %= (int32_t) tic_tps;
+	if (d >= half) d -= tic_tps; else if (d < -half) d += tic_tps;	//-1/2s..+1/2s
+	if (tic_ok == 0) {tic_ok = 1; tic_phase = d;}	//first reading
+	else {
+		dd = d - tic_prev;
+		if (dd >= half) dd -= tic_tps; else if (dd < -half) dd += tic_tps;
+		tic_phase += dd;
+	}
+	tic_prev = d;
+	//ticks -> ns, at the nominal rate: whole seconds and the rest, to stay within 64 bits
+	return tic_phase / tic_tps * 1000000000ll + tic_phase % tic_tps * 1000000000ll / tic_tps;
+}
+#endif
+	
+#if defined(ISR_DEFER)
+//gate arithmetic on a raw capture queued by the isr, run in main
+//return 1 and fill in cap->ticks / cap->flags at the end of a gate, 0 otherwise
+uint8_t freqc_gate(cap_t *cap) {
+	uint32_t t1 = cap->tick;			//the isr rewrites tick1 on every edge: work on a local copy
+	
+	if (cap->flags & CAP_OVF) {			//captures were dropped: restart the gate on this one
+		freqc_state = FREQC_WAIT;
+		gate_flags |= CAP_OVF;
+	}
+	if (freqc_state == FREQC_WAIT) {	//first pulse: start the gate on it
+		gate_tick0 = t1;
+		pps_cnt = pps_len = GATE_NEXT();
+		freqc_state = FREQC_RUN;
+		gate_flags |= CAP_FIRST;
+		return 0;
+	}
+	pps_cnt -= 1;						//decrement pps_cnt
+	if (pps_cnt) return 0;
+	pps_cnt = GATE_NEXT();				//reset pps_cnt, to the length of the next gate
+	cap->ticks = (t1 - gate_tick0) << pbdiv;	//32-bit capture means no need to know F_CLK. correct for PBDIV
+	cap->gate  = pps_len;
+	cap->flags = gate_flags;
+	gate_flags = 0;
+	gate_tick0 = t1;					//update gate_tick0
+	pps_len = pps_cnt;
+	IO_FLP(LED_PORT, LED);				//flip led
+	return 1;
+}
+#endif
+
 //reset frequency calibrator
 void freqc_init(void) {
 	//tick0=tick1=0;
-	freq_available = 0;					//0->no new data
+	cap_head = cap_tail = 0;			//empty capture ring
+	cap_flags = 0; cap_ovf = 0;
+#if defined(ISR_DEFER)
+	gate_flags = 0;
+#endif
 	//freq = F_CLK;						//initial value of freq
-	pps_cnt = PPS_CNT;					//reset 1pps pulse counter, downcounter
+	pps_cnt = pps_len = PPS_CNT;		//reset 1pps pulse counter, downcounter
+#if defined(AR_USED)
+	pps_gate = gate = PPS_CNT;			//start from the default gate
+	ar_cnt = 0;
+#endif
 	freq_sum = 0;						//(F_CLK << OSCCONbits.PBDIV) * FREQ_CNT;	//initialize freq_sum: PBDIV=8
 	//freq_avg = freq_sum / FREQ_CNT;		//optional
+#if defined(KF_USED)
+	kf.n = 0;							//seed the kalman filter with the first reading
+#endif
+#if defined(NV_USED)
+	nv_cnt = NV_FIRST;					//reset the save counter
+	if (nv_read(&nv) == 0) {			//valid calibration from the last run: start from it
+#if defined(KF_USED)
+		kf_seed(&kf, nv.freq, nv.frac, nv.drift);
+#else
+		freq_sum = nv.freq * FREQ_CNT + (((uint64_t) nv.frac * FREQ_CNT) >> 32);
+		freq_avg = freq_sum / FREQ_CNT;
+#endif
+	} else nv.trim = OSCTUN_DEF;		//no calibration: default trim
+#endif
+#if defined(TC_USED)
+	tc_init(&tc);						//nothing learned yet
+	TEMP_PIN();							//temperature sensor pin as analog input
+	adc1_init();						//reset the adc
+#endif
 	
 	//optional - calibrate FRC
 	//DMA / interupts assumed disabled here
 	SYSKEY = 0xaa996655ul; SYSKEY = 0x556699aaul;	//unlock sequence
-	OSCTUN = -5;						//change osctun: 12.5% / 32
+#if defined(NV_USED)
+	OSCTUN = nv.trim;					//change osctun: trim from the last run
+#else
+	OSCTUN = OSCTUN_DEF;				//change osctun: 12.5% / 32
+#endif
 	OSCCON = (OSCCON &~(3<<19)) | 		//trim FRC
 	//set PBDIV
 #if   SET_PBDIV==1
@@ -186,31 +577,257 @@ void freqc_init(void) {
 				(3<<19);	//PBDIV: 3->8x (default)
 #endif
 	SYSKEY = 0x33333333ul;				//lock by writing any non critical value
+#if defined(EXTCLK_USED)
+	pbdiv = 0;							//the timebase counts the external clock: no PBDIV correction
+#else
+	pbdiv = OSCCONbits.PBDIV;			//cached for the gate arithmetic
+#endif
 	
+#if defined(EXTCLK_USED)
+	EXTCLK_PIN();						//external clock into T2CK
+#endif
 	tmr23_init();						//reset tmr2
+#if defined(TOD_USED)
+#if defined(EXTCLK_USED)
+	todclk_init(0);						//rate unknown until the first gate
+#else
+	todclk_init(F_PHB);					//nominal rate until the first gate
+#endif
+#endif
 	//configure the input capture pin ICP1
 	IC1_PIN();
 	ic1_init();							//reset ic1
-	//wait for the first capture event
-	while (ICxIF == 0) continue;
-	tick0 = ICxBUF;						//read the first capture
-	ICxIF = 0;							//clear the flag after having read the buffer - flag is persistent so the read order has to be maintained
+#if defined(TIC_USED)
+	tic_init();							//local 1pps and its capture
+#endif
+	//don't wait for the first capture: the isr starts the gate on it
+	freqc_state = FREQC_WAIT;			//waiting for the first 1pps pulse
 	ICxIE = 1;							//enable the interrupt
 }
 	
+#if defined(AR_USED)
+//auto-ranging: bring the filter / average to the gate of a reading, a power of 2 away
+void ar_scale(uint8_t g) {
+	for (; gate < g; gate <<= 1) {
+#if defined(KF_USED)
+		if (kf.n) kf_scale(&kf, 1);
+#endif
+		freq_sum *= 2;
+	}
+	for (; gate > g; gate >>= 1) {
+#if defined(KF_USED)
+		if (kf.n) kf_scale(&kf, 0);
+#endif
+		freq_sum /= 2;
+	}
+	freq_avg = freq_sum / FREQ_CNT;
+	ar_cnt = 0;							//observe the new gate from scratch
+}
+
+//auto-ranging: observe the stability at the current gate, and pick the next one
+//the deviation is the allan deviation at the gate: white phase noise (the capture quantization,
+//the 1pps jitter) halves with each doubling of the gate, so one that meets AR_PPB / 2 can be halved.
+//a further sqrt(2) of margin, and an estimate over up to 4 x AR_N gates, keep its own scatter from toggling the gate
+void ar_update(int32_t ticks) {
+	int32_t d;
+	uint64_t var, thr;
+	
+	d = ticks - ar_prev;
+	ar_prev = ticks;
+	if (ar_cnt == 0 || d > (ticks >> 10) || d < -(ticks >> 10)) {ar_cnt = 1; ar_sum = 0; return;}	//first reading, or a missed pulse: start over
+	ar_sum += (int64_t) d * d;
+	if (ar_cnt++ % AR_N) return;
+	var = (ar_sum << 16) / (2 * (ar_cnt - 1));	//allan variance, Q16 ticks^2
+	thr = (uint64_t) ticks * AR_PPB * 256 / 1000000000ul;	//AR_PPB in ticks, Q8
+	thr *= thr;
+	if (var > thr && pps_gate < AR_MAX) pps_gate <<= 1;	//short of it: longer gate
+	else if (var * 8 <= thr && pps_gate > 1) pps_gate >>= 1;	//met at half the gate too, with margin: shorter gate
+	if (ar_cnt > 4 * AR_N) {ar_sum >>= 1; ar_cnt = (ar_cnt >> 1) + 1;}	//forget the older half
+}
+#endif
+
+#if defined(SELFTEST_USED)
+//self-test: (re)start the pulses at a period of pr ticks, and the gate on their next edge
+//the capture path is the same as with the 1pps: isr, ring, gate arithmetic
+void st_start(uint32_t pr) {
+	ICxIE = OCzIE = 0;					//no captures / pulses while the period changes
+	st_pr = pr;
+	OCzR  = TMRx + pr;					//first pulse a period from now
+	OCzRS = OCzR + pr / 2;				//50% duty cycle
+	while (ICxCON & (1<<3)) (void) ICxBUF;	//flush the captures of the old period: 1->buffer not empty
+	cap_tail = cap_head;				//and their records
+	cap_flags = 0;
+	freqc_state = FREQC_WAIT;			//the next edge starts the gate
+	isr_lat = isr_dur = 0;				//isr statistics per window
+	OCzIF = ICxIF = 0;
+	OCzIE = ICxIE = 1;
+}
+
+//self-test: sweep the pulses from ST_PR_MAX ticks down, 1/8 faster every window while no gate is
+//dropped or wrong, then hold them at 2/3 of the fastest clean rate and keep checking. never returns
+//OC4 runs off the 32-bit timer2/3 pair in 32-bit dual compare mode, as the tic's OC3: its isr moves
+//each pulse a period on, a few instructions that are part of the load. the sweep ends, at the latest,
+//where that isr can't keep up - a pulse is then missed, and the window sees no gate
+void selftest(void) {
+	uint32_t pr = ST_PR_MAX, pr_ok = 0;	//current / fastest clean period
+	uint8_t sweep = 1;					//1->sweeping, 0->holding
+	uint32_t t, gates, errs, ovf;
+	cap_t cap;
+	
+	PWM4_TO_RP(); IO_OUT(TRISA, 1<<4);	//OC4 out on RA4, input capture 1 reads it back
+	OCzMD = 0;							//0->enable power to output compare
+	OCzCON  =	(0<<15) |				//1->enable the module, 0->disable the module
+				(0<<13) |				//0->operates in idle, 1->don't operate in idle
+				(1<< 5) |				//1->32-bit compare, 0->16-bit compare
+				(0<< 3) |				//0->timer2 as timebase, 1->timer3 as timebase
+				(5<< 0) |				//5->dual compare, continuous pulses. interrupt on the falling edge
+				0x00;
+	OCzR  = TMRx + pr; OCzRS = OCzR + pr / 2;
+	OCzIF = 0;
+	OCzIP = ICxIP + 1;					//above the capture
+	OCzCON |= (1<<15);
+	while (1) {
+		st_start(pr);
+		gates = errs = 0; ovf = cap_ovf;
+		t = CT_GET();
+		while ((CT_GET() - t) < ST_MS * (CT_TICKS / 1000)) {
+			while (cap_tail != cap_head) {
+				cap = cap_buf[cap_tail % CAP_N];
+				cap_tail += 1;
+#if defined(ISR_DEFER)
+				if (freqc_gate(&cap) == 0) continue;	//not the end of a gate yet
+#endif
+				gates += 1;
+				if (cap.ticks != (int32_t) (pr * cap.gate) << pbdiv) errs += 1;	//against the exact answer
+			}
+		}
+		ICxIE = OCzIE = 0;				//window closed: no captures while reporting
+		ovf = (uint16_t) (cap_ovf - ovf);
+		sprintf(uRAM, "selftest: %5lu ticks, %7lu captures/s, %2lu errors, %4lu dropped, isr %u / %u ticks.\n\r",
+			pr, gates * PPS_CNT * 1000 / ST_MS, errs, ovf, isr_lat, isr_dur);
+		uart1_puts(uRAM);
+		if (errs == 0 && ovf == 0 && gates) {	//clean window
+			if (sweep == 0) continue;
+			pr_ok = pr;
+			if (pr > ST_PR_MIN) {pr -= pr / 8; if (pr < ST_PR_MIN) pr = ST_PR_MIN; continue;}
+		} else if (sweep == 0) {
+			uart1_puts("selftest: FAIL.\n\r");
+			continue;
+		}
+		//end of the sweep
+		sweep = 0;
+		if (pr_ok == 0) {uart1_puts("selftest: FAIL - no clean window.\n\r"); continue;}
+		sprintf(uRAM, "selftest: max %lu captures/s.\n\r", F_PHB / pr_ok);
+		uart1_puts(uRAM);
+		pr = pr_ok + pr_ok / 2;			//hold with some margin
+		if (pr > ST_PR_MAX) pr = ST_PR_MAX;
+	}
+}
+#endif
+
+#if defined(TC_USED)
+//read the temperature, 16x oversampled
+void temp_read(void) {
+	uint8_t i;
+
+	for (temp = 0, i = 0; i < 16; i++) temp += adc1_read(TEMP_AN);
+}
+
+//report the temperature and the frequency the model predicts at it
+//with or without the 1pps: without it, the prediction stands in for the measurement
+void tc_report(void) {
+	uint32_t tmp;
+
+	strcpy(uRAM, str1);
+	tmp = (uint32_t) temp * TEMP_MV_REF / 16384;	//sensor output, mv = 0.1C above TEMP_MV_0C
+	if (tmp < TEMP_MV_0C) {uRAM[7] = '-'; tmp = TEMP_MV_0C - tmp;} else tmp = tmp - TEMP_MV_0C;
+	uRAM[12]=(tmp % 10) + '0'; tmp /= 10;
+	uRAM[10]=(tmp % 10) + '0'; tmp /= 10;
+	if (tmp) {uRAM[ 9]=(tmp % 10) + '0'; tmp /= 10;}	//eliminate the leading zeros
+	if (tmp) {uRAM[ 8]=(tmp % 10) + '0'; tmp /= 10;}
+	tmp = tc_freq(&tc, temp, &tc_frac);
+	uRAM[29]=(tmp % 10) + '0'; tmp /= 10;
+	if (tmp) {uRAM[28]=(tmp % 10) + '0'; tmp /= 10;}	//eliminate the leading zeros
+	if (tmp) {uRAM[27]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[26]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[25]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[24]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[23]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[22]=(tmp % 10) + '0'; tmp /= 10;}
+	if (tmp) {uRAM[21]=(tmp % 10) + '0'; tmp /= 10;}
+	tmp = ((uint64_t) tc_frac * 1000) >> 32;
+	uRAM[33]=(tmp % 10) + '0'; tmp /= 10;
+	uRAM[32]=(tmp % 10) + '0'; tmp /= 10;
+	uRAM[31]=(tmp % 10) + '0'; tmp /= 10;
+	uart1_puts(uRAM);
+}
+#endif
+
 int main(void) {
 	uint32_t tmp;
+	cap_t cap;							//current capture record
+	uint16_t ovf = 0;					//cap_ovf last reported
+#if defined(AR_USED) || defined(TOD_USED)
+	uint64_t tmp64;
+#endif
+#if defined(ISR_STATS)
+	uint16_t lat = 0, dur = 0;			//isr_lat / isr_dur last reported
+#endif
+#if defined(TIC_USED)
+	uint8_t rseq = 0;					//tic_rseq last seen
+#endif
+#if defined(NMEA_USED)
+	uint8_t nseq = 0;					//nmea_seq last seen
+	uint32_t n;							//its edge
+	int64_t utc;						//and time
+#endif
 	
 	mcu_init();							//reset the mcu
 	IO_SET(LED_PORT, LED); IO_OUT(LED_DDR, LED);				//led as output
-	freqc_init();						//reset the frequency calibrator
-	uart1_init(9600);					//reset uart
+	freqc_init();						//reset the frequency calibrator - returns without waiting for the 1pps
+	uart1_init(9600);					//reset uart, after freqc_init() has set PBDIV
+#if defined(NMEA_USED)
+	nmea_init(&nmea);
+	NMEA_PIN();							//gps tx into U1RX
+	U1STAbits.URXEN = 1;				//1->enable the receiver
+	IFS1bits.U1RXIF = 0;				//0->clear the flag
+	IPC8bits.U1IP = 1;
+	IEC1bits.U1RXIE = 1;				//1->enable the interrupt
+#endif
 	ei();								//enable global interrupts
+#if defined(SELFTEST_USED)
+	selftest();							//production test: no 1pps, never returns
+#endif
 	while (1) {
-		if (freq_available) {			//new data has arrived
-			freq_available = 0;			//data has been read, no new data now
+#if defined(NMEA_USED)
+		if (nmea_seq != nseq) {			//a good sentence: the utc of the edge it followed
+			do {nseq = nmea_seq; utc = nmea.utc; n = nmea_pps;} while (nseq != nmea_seq);	//a consistent copy
+			if (utc_ok == 0 || utc - n != utc_off) {	//first one, or edges were missed: renumber them
+				utc_off = utc - n; utc_ok = 1;
+#if defined(TOD_USED)
+				todclk_set(utc + (pps_num - n));	//the time of day too: second of the last edge
+#endif
+			}
+		}
+#endif
+		while (cap_tail != cap_head) {	//new data has arrived: process every record in the ring
+			cap = cap_buf[cap_tail % CAP_N];	//copy the record out, then free its slot
+			cap_tail += 1;
+#if defined(ISR_DEFER)
+			if (freqc_gate(&cap) == 0) continue;	//not the end of a gate yet
+#endif
+			freq = cap.ticks;			//frequency measurement
+#if defined(AR_USED)
+			if (cap.gate != gate) ar_scale(cap.gate);	//first reading at a new gate
+#endif
 			
 			//smoothing the reading
+#if defined(KF_USED)
+			if (kf.n == 0) kf_init(&kf, freq);	//first reading seeds the filter
+			else kf_update(&kf, freq);
+			freq_avg = kf_freq(&kf, &kf_frac);
+			freq_f   = ((uint64_t) kf_frac * FREQ_CNT) >> 32;	//fractional frequency, in 1/FREQ_CNT
+#else
 			//only run for the first time
 			if (freq_sum==0) {			//on the first run, freq_sum is initialized to 0
 				freq_sum = freq * FREQ_CNT;	//initialize freq_sum to freq * FREQ_CNT -> its expected value
@@ -221,13 +838,71 @@ int main(void) {
 			//freq_i   = freq_sum / FREQ_CNT;
 			//calculate the fractional frequency
 			freq_f   = freq_sum - freq_avg * FREQ_CNT;
+#endif
+#if defined(AR_USED)
+			ar_update(freq);			//observe the stability, pick the next gate
+#endif
+#if defined(TOD_USED)
+			//timebase ticks per second, for the time of day: per gate, in sysclk ticks
+#if defined(KF_USED)
+			tmp64 = ((uint64_t) freq_avg << 32) + kf_frac;
+#else
+			tmp64 = ((uint64_t) freq_avg << 32) + ((uint64_t) freq_f << 32) / FREQ_CNT;
+#endif
+#if defined(AR_USED)
+			todclk_rate((tmp64 / gate) >> pbdiv);
+#else
+			todclk_rate((tmp64 / PPS_CNT) >> pbdiv);
+#endif
+#endif
+#if defined(NV_USED)
+			//save the calibration - rarely, for flash endurance
+			if (--nv_cnt == 0) {
+				nv_cnt = NV_EVERY;
+#if defined(KF_USED)
+				nv.freq = kf_freq(&kf, &nv.frac);
+				nv.drift = kf.x[2];			//|drift| < 1/2 tick per gate^2
+#else
+				nv.freq = freq_avg;
+				nv.frac = ((uint64_t) freq_f << 32) / FREQ_CNT;
+				nv.drift = 0;
+#endif
+#if defined(AR_USED)
+				//saved for a gate of PPS_CNT: the next run starts with it
+				tmp64 = ((((uint64_t) nv.freq << 32) + nv.frac) / gate) * PPS_CNT;
+				nv.freq = tmp64 >> 32; nv.frac = tmp64;
+				nv.drift = nv.drift / gate / gate * PPS_CNT * PPS_CNT;
+#endif
+				nv.trim = OSCTUN;
+				nv_write(&nv);
+			}
+#endif
+#if defined(TC_USED)
+			//read the temperature and learn the raw reading at it - the bins do the averaging
+			temp_read();
+#if defined(AR_USED)
+			tc_learn(&tc, temp, (int64_t) freq * PPS_CNT / gate, 0);	//learned for a gate of PPS_CNT
+#else
+			tc_learn(&tc, temp, freq, 0);
+#endif
+#endif
 			
 			//convert freq for transmission
 			//forming the display string
 #if 1
 			//for the integer part of the string
 			//tmp = freq;					//display freq
+#if defined(AR_USED)
+			//per 1pps pulse, whatever the gate
+#if defined(KF_USED)
+			tmp64 = (((uint64_t) freq_avg << 32) + kf_frac) / gate;
+#else
+			tmp64 = (((uint64_t) freq_avg << 32) + ((uint64_t) freq_f << 32) / FREQ_CNT) / gate;
+#endif
+			tmp = tmp64 >> 32;
+#else
 			tmp = freq_avg;
+#endif
 			strcpy(uRAM, str0);			//initialize uart buffer
 			uRAM[15]=(tmp % 10) + '0'; tmp /= 10;
 			uRAM[14]=(tmp % 10) + '0'; tmp /= 10;
@@ -239,20 +914,79 @@ int main(void) {
 			uRAM[ 8]=(tmp % 10) + '0'; tmp /= 10;
 			if (tmp) {uRAM[ 7]=(tmp % 10) + '0'; tmp /= 10;}	//eliminate the leading zero
 			//optional: form the fractional part of the string
+#if defined(AR_USED)
+			tmp = ((uint64_t) (uint32_t) tmp64 * 1000) >> 32;
+#elif defined(KF_USED)
+			tmp = ((uint64_t) kf_frac * 1000) >> 32;
+#else
 			tmp = freq_f * 1000 / FREQ_CNT;
+#endif
 			uRAM[19]=(tmp % 10) + '0'; tmp /= 10;
 			uRAM[18]=(tmp % 10) + '0'; tmp /= 10;
 			uRAM[17]=(tmp % 10) + '0'; tmp /= 10;
+#if defined(KF_USED)
+			//1-sigma uncertainty of the filter, ppb
+			tmp = ((uint64_t) kf_sigma(&kf) * 1000000000ul / freq_avg) >> 16;
+			uRAM[31]=(tmp % 10) + '0'; tmp /= 10;
+			if (tmp) {uRAM[30]=(tmp % 10) + '0'; tmp /= 10;}	//eliminate the leading zeros
+			if (tmp) {uRAM[29]=(tmp % 10) + '0'; tmp /= 10;}
+			if (tmp) {uRAM[28]=(tmp % 10) + '0'; tmp /= 10;}
+			if (tmp) {uRAM[27]=(tmp % 10) + '0'; tmp /= 10;}
+#endif
+#if defined(AR_USED)
+			//the gate of this reading, s
+			tmp = gate;
+			uRAM[sizeof(str0) - 6]=(tmp % 10) + '0'; tmp /= 10;
+			if (tmp) {uRAM[sizeof(str0) - 7]=(tmp % 10) + '0'; tmp /= 10;}	//eliminate the leading zeros
+			if (tmp) {uRAM[sizeof(str0) - 8]=(tmp % 10) + '0'; tmp /= 10;}
+#endif
 			
 #else		//for debugging
 			//sprintf(uRAM, "freq = %8dHz.\n\r");
 			//sprintf(uRAM, "freq_sum=%12ld, freq_i=%12ld, freq_f=%12ld\n\r", freq_sum, freq_i, freq_f);
 			sprintf(uRAM, "freq = %10ldHz, freq = %10ld.%03dHz.\n\r", freq, freq_avg, freq_f * 1000 / FREQ_CNT);
+#endif
+#if defined(NMEA_USED)
+			//utc second of the 1pps edge the gate ended on: lines from different calibrators line up on it
+			if (utc_ok) sprintf(uRAM + sizeof(str0) - 4, ", utc = %lld.\n\r", (int64_t) cap.pps + utc_off);
 #endif
 			uart1_puts(uRAM);			//start transmission
+#if defined(TC_USED)
+			tc_report();				//frequency predicted by the model at the current temperature
+#endif
 
 			//IO_FLP(LED_PORT, LED);		//flip the led
 		}	
+		if (cap_ovf != ovf) {			//records were dropped: report it
+			ovf = cap_ovf;
+			sprintf(uRAM, "overflow = %u records.\n\r", ovf);
+			uart1_puts(uRAM);
+		}
+#if defined(ISR_STATS)
+		if (isr_lat != lat || isr_dur != dur) {	//new worst case: report it
+			lat = isr_lat; dur = isr_dur;
+			sprintf(uRAM, "isr: latency <= %u, duration <= %u ticks.\n\r", lat, dur);
+			uart1_puts(uRAM);
+		}
+#endif
+#if defined(TIC_USED)
+		if (tic_rseq != rseq && tic_lseq) {	//a 1pps edge, with the local 1pps running: its phase, every second
+			rseq = tic_rseq;
+			sprintf(uRAM, "phase = %lldns.\n\r", tic_update(tic_ref - tic_loc));
+			uart1_puts(uRAM);
+		}
+#endif
+		//1pps watchdog: report when it's missing, re-acquire when it comes back
+		if (pps_seen) {pps_seen = 0; pps_time = CT_GET();}
+		else if ((CT_GET() - pps_time) > PPS_TIMEOUT * CT_TICKS) {
+			pps_time = CT_GET();		//report once every PPS_TIMEOUT
+			freqc_state = FREQC_WAIT;	//the next pulse restarts the gate
+			uart1_puts("waiting for PPS...\n\r");
+#if defined(TC_USED)
+			//no 1pps: report the frequency the model predicts at the current temperature
+			if (tc.f0) {temp_read(); tc_report();}
+#endif
+		}
 		//delay_ms(100);				//waste sometime
 		//uart1_puts("testing...\n\r");	//for debugging
     }
@@ -0,0 +1,121 @@
+//source file for the streaming nmea parser
+
+#include "nmea.h"						//we use nmea parser
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+#define NMEA_SIDLE		0					//waiting for a '$'
+#define NMEA_SBODY		1					//in the fields
+#define NMEA_SSUM1		2					//checksum, first digit
+#define NMEA_SSUM2		3					//checksum, second digit
+#define NMEA_GTIME		(1<<0)				//fields seen
+#define NMEA_GSTAT		(1<<1)				//RMC: status A, the receiver has a fix
+#define NMEA_GDAY		(1<<2)
+#define NMEA_GMON		(1<<3)
+#define NMEA_GYEAR		(1<<4)
+#define NMEA_GDATE		(NMEA_GDAY | NMEA_GMON | NMEA_GYEAR)
+#define NMEA_ADDR(a, b, c)	(((uint32_t) (a) << 16) | ((uint32_t) (b) << 8) | (c))	//last 3 bytes of an address
+
+//global variables
+
+//days since the epoch of a civil date, y >= 1970
+static int32_t nmea_days(uint16_t y, uint8_t m, uint8_t d) {
+	uint32_t era, yoe, doy, doe;
+
+	y -= m <= 2;
+	era = y / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+//value of a hex digit, 16 if it isn't one
+static uint8_t nmea_hex(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return 16;
+}
+
+//end of a field: keep what we need of it
+static void nmea_field(nmea_t *p) {
+	if (p->field == 0) {				//address: ours or not
+		p->acc &= 0x00fffffful;
+		p->type = (p->acc == NMEA_ADDR('R', 'M', 'C')) ? NMEA_RMC : (p->acc == NMEA_ADDR('Z', 'D', 'A')) ? NMEA_ZDA : 0;
+		if (p->type == 0) p->state = NMEA_SIDLE;	//skip the rest of it
+		return;
+	}
+	if (p->field == 1) {				//hhmmss[.sss], both
+		if (p->nd == 6) {p->hms = p->acc; p->got |= NMEA_GTIME;}
+		return;
+	}
+	if (p->type == NMEA_RMC) {			//ddmmyy in field 9
+		if (p->field == 9 && p->nd == 6) {
+			p->day = p->acc / 10000; p->mon = p->acc / 100 % 100; p->year = p->acc % 100 + ((p->acc % 100 < 80) ? 2000 : 1900);
+			p->got |= NMEA_GDATE;
+		}
+		return;
+	}
+	switch (p->field) {					//ZDA: dd, mm, yyyy in fields 2..4
+		case 2: if (p->nd == 2) {p->day = p->acc; p->got |= NMEA_GDAY;} break;
+		case 3: if (p->nd == 2) {p->mon = p->acc; p->got |= NMEA_GMON;} break;
+		case 4: if (p->nd == 4) {p->year = p->acc; p->got |= NMEA_GYEAR;} break;
+	}
+}
+
+//end of a sentence, checksum good: its time
+static uint8_t nmea_done(nmea_t *p) {
+	uint8_t h = p->hms / 10000, m = p->hms / 100 % 100, s = p->hms % 100;
+
+	if ((p->got & (NMEA_GTIME | NMEA_GDATE)) != (NMEA_GTIME | NMEA_GDATE)) return 0;
+	if (p->type == NMEA_RMC && (p->got & NMEA_GSTAT) == 0) return 0;	//no fix
+	if (h > 23 || m > 59 || s > 60 || p->mon < 1 || p->mon > 12 || p->day < 1 || p->day > 31 || p->year < 1970) return 0;
+	p->utc = (int64_t) nmea_days(p->year, p->mon, p->day) * 86400 + (uint32_t) h * 3600 + m * 60 + s;
+	return 1;
+}
+
+//reset the parser
+void nmea_init(nmea_t *p) {
+	p->state = NMEA_SIDLE;
+	p->utc = 0;
+}
+
+//next byte of the stream
+uint8_t nmea_put(nmea_t *p, char c) {
+	uint8_t v;
+
+	if (c == '$') {						//start of a sentence, wherever we were
+		p->state = NMEA_SBODY;
+		p->type = p->field = p->nd = p->dot = p->got = p->sum = 0;
+		p->acc = 0;
+		return 0;
+	}
+	switch (p->state) {
+		case NMEA_SBODY:
+			if (c == '*') {nmea_field(p); if (p->state == NMEA_SBODY) p->state = NMEA_SSUM1; return 0;}
+			if (c < ' ' || c > '~') {p->state = NMEA_SIDLE; return 0;}	//end of line before the checksum, or noise
+			p->sum ^= c;
+			if (c == ',') {				//next field
+				nmea_field(p);
+				p->field += 1; p->nd = p->dot = 0; p->acc = 0;
+			} else if (p->field == 0) p->acc = (p->acc << 8) | (uint8_t) c;	//address
+			else if (c >= '0' && c <= '9') {
+				if (p->dot == 0 && p->nd < 9) {p->acc = p->acc * 10 + (c - '0'); p->nd += 1;}
+			} else if (c == '.') p->dot = 1;
+			else if (c == 'A' && p->type == NMEA_RMC && p->field == 2) p->got |= NMEA_GSTAT;
+			return 0;
+		case NMEA_SSUM1:
+			if ((v = nmea_hex(c)) > 15) {p->state = NMEA_SIDLE; return 0;}
+			p->chk = v << 4;
+			p->state = NMEA_SSUM2;
+			return 0;
+		case NMEA_SSUM2:
+			p->state = NMEA_SIDLE;
+			if ((v = nmea_hex(c)) > 15 || (p->chk | v) != p->sum) return 0;	//bad checksum
+			return nmea_done(p);
+	}
+	return 0;								//NMEA_SIDLE: between sentences
+}
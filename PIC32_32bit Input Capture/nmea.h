@@ -0,0 +1,46 @@
+#ifndef NMEA_H_INCLUDED
+#define NMEA_H_INCLUDED
+
+#include "gpio.h"
+
+//streaming nmea parser: utc time from RMC / ZDA sentences, any talker ($GPRMC, $GNZDA, ...)
+//fed one byte at a time, e.g. from the uart rx isr: there is no sentence buffer - the fields
+//are converted as they go by and the checksum is checked at the end, so a sentence costs a few
+//instructions per byte and no copy. other sentences are skipped at their address field.
+//a sentence is dropped if its checksum is bad or missing, a field is missing, or (RMC) the
+//receiver has no fix. the time is that of the 1pps edge the sentence follows.
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+#define NMEA_RMC		1					//sentence types
+#define NMEA_ZDA		2
+
+//parser state
+typedef struct {
+	uint8_t state;						//NMEA_Sxxx, see nmea.c
+	uint8_t type;						//sentence being parsed, NMEA_xxx, 0->not one of ours
+	uint8_t field;						//field number, 0->address
+	uint8_t nd;							//digits in the field, before any '.'
+	uint8_t dot;						//1->past the '.' in the field
+	uint8_t got;						//fields seen, one bit each
+	uint8_t sum;						//xor of the bytes between '$' and '*'
+	uint8_t chk;						//checksum received
+	uint32_t acc;						//value of the field so far / last 4 bytes of the address
+	uint32_t hms;						//hhmmss
+	uint16_t year;
+	uint8_t mon, day;
+	int64_t utc;						//last good time, seconds since the epoch
+} nmea_t;
+
+//global variables
+
+//reset the parser
+void nmea_init(nmea_t *p);
+
+//next byte of the stream
+//return 1 if it completed a good sentence: its time is in p->utc, until the next one
+uint8_t nmea_put(nmea_t *p, char c);
+
+#endif /* NMEA_H_INCLUDED */
@@ -0,0 +1,59 @@
+//source file for the nonvolatile calibration record on PIC32 flash
+
+#include "nvm.h"						//we use nvm
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+#define NVMOP_WORD			0x1			//program one word
+#define NVMOP_ERASE			0x4			//erase one page
+#define KVA_PA(addr)		((uint32_t) (addr) & 0x1ffffffful)	//virtual -> physical address
+#define KVA_K1(addr)		(KVA_PA(addr) | 0xa0000000ul)		//virtual -> uncached (kseg1) address
+
+//global variables
+//reserved flash page, page aligned so erasing it doesn't touch the code
+static const uint8_t nv_flash[NVM_PAGE] __attribute__((aligned(NVM_PAGE))) = {0xff};
+
+//checksum: fletcher-16, keyed
+static uint16_t nv_chk(const uint8_t *p, uint8_t n) {
+	uint16_t s1 = 0, s2 = 0;
+
+	while (n--) {s1 = (s1 + *p++) % 255; s2 = (s2 + s1) % 255;}
+	return ((s2 << 8) | s1) ^ NV_KEY;
+}
+
+//run one nvm operation
+//return WRERR | LVDERR
+static uint32_t nvm_op(uint32_t op) {
+	NVMCON = (1<<14) | op;				//1->enable writes, operation
+	di();								//the unlock sequence can't be interrupted
+	NVMKEY = 0xaa996655ul; NVMKEY = 0x556699aaul;	//unlock sequence
+	NVMCONSET = (1<<15);				//1->start the operation
+	ei();
+	while (NVMCON & (1<<15)) continue;	//wait for the operation to finish
+	NVMCONCLR = (1<<14);				//0->disable writes
+	return NVMCON & (3<<12);			//WRERR | LVDERR
+}
+
+//read the calibration record
+int8_t nv_read(nv_t *nv) {
+	*nv = *(const volatile nv_t *) KVA_K1(nv_flash);	//read around the cache / prefetch
+	return (nv->chk == nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk))) ? 0 : -1;
+}
+
+//write the calibration record
+int8_t nv_write(nv_t *nv) {
+	const uint32_t *p = (const uint32_t *) nv;
+	uint8_t i;
+
+	nv->chk = nv_chk((const uint8_t *) nv, sizeof(nv_t) - sizeof(nv->chk));
+	NVMADDR = KVA_PA(nv_flash);			//erase the page
+	if (nvm_op(NVMOP_ERASE)) return -1;
+	for (i = 0; i < sizeof(nv_t) / 4; i++) {	//then program it, one word at a time
+		NVMADDR = KVA_PA(nv_flash) + i * 4;
+		NVMDATA = p[i];
+		if (nvm_op(NVMOP_WORD)) return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef NVM_H_INCLUDED
+#define NVM_H_INCLUDED
+
+#include "gpio.h"
+
+//hardware configuration
+#define NVM_PAGE				1024				//flash erase page, bytes. 1024 on PIC32MX1xx/2xx, 4096 on PIC32MX3xx-7xx
+#define NV_KEY					0xa55a				//checksum key: blank flash (all 0x00 / 0xff) doesn't pass
+//end hardware configuration
+
+//global defines
+
+//calibration record, kept in a reserved flash page
+typedef struct {
+	int32_t freq;						//learned frequency, integer part, ticks per gate
+	uint32_t frac;						//learned frequency, fractional part, Q0.32
+	int32_t drift;						//learned drift, Q0.32 ticks per gate^2
+	int16_t trim;						//oscillator trim, OSCTUN
+	uint16_t chk;						//checksum over the fields above, filled in by nv_write()
+} nv_t;
+
+//global variables
+
+//read the calibration record
+//return 0 if valid, -1 if blank / corrupted
+int8_t nv_read(nv_t *nv);
+
+//write the calibration record
+//erases and programs a flash page - the cpu stalls for ~20ms and the endurance is ~20k cycles: call rarely
+//return 0 if successful, -1 otherwise
+int8_t nv_write(nv_t *nv);
+
+#endif /* NVM_H_INCLUDED */
@@ -0,0 +1,61 @@
+//source file for the temperature compensation model
+//frequency vs. temperature, as a table of bins averaged online
+//a table rather than a polynomial: FRC / crystal curves are not low-order near the turnover,
+//learning is o(1) per reading and a bin is only touched when the temperature is there
+
+#include "tempco.h"						//we use temperature compensation
+
+//global defines
+#define TC_W				(1<<TC_SHIFT)	//bin width, codes
+
+//global variables
+
+//reset the model
+void tc_init(tc_t *tc) {
+	uint8_t i;
+
+	tc->f0 = 0;							//nothing learned yet
+	for (i = 0; i < TC_BINS; i++) tc->bin[i] = tc->cnt[i] = 0;
+}
+
+//bin for a temperature, clamped to the table
+static uint8_t tc_bin(uint16_t temp) {
+	if (temp < TC_LO) return 0;
+	temp = (temp - TC_LO) >> TC_SHIFT;
+	return (temp < TC_BINS) ? temp : TC_BINS - 1;
+}
+
+//learn one frequency reading
+void tc_learn(tc_t *tc, uint16_t temp, int32_t freq, uint32_t frac) {
+	uint8_t i = tc_bin(temp);
+	int32_t v;
+
+	if (tc->f0 == 0) tc->f0 = freq;		//the first reading sets the reference
+	v = (freq - tc->f0) * 256 + (frac >> 24);	//offset from f0, 1/256Hz
+	if (tc->cnt[i] == 0) tc->bin[i] = v * TC_CNT;	//first reading in this bin
+	else tc->bin[i] += v - tc->bin[i] / TC_CNT;		//same smoothing as freq_sum
+	if (tc->cnt[i] != 0xffff) tc->cnt[i] += 1;
+}
+
+//predicted frequency
+int32_t tc_freq(tc_t *tc, uint16_t temp, uint32_t *frac) {
+	int32_t pos, lo, hi, v;
+
+	*frac = 0;
+	if (tc->f0 == 0) return 0;			//nothing learned yet
+	//position in the table, in codes, and the learned bins on either side of it
+	pos = (temp < TC_LO) ? 0 : (int32_t) temp - TC_LO;
+	if (pos > TC_BINS * TC_W - 1) pos = TC_BINS * TC_W - 1;
+	lo = (pos - TC_W / 2) >> TC_SHIFT;	//bin center at or below pos
+	hi = lo + 1;
+	while (lo >= 0 && tc->cnt[lo] == 0) lo -= 1;
+	while (hi < TC_BINS && tc->cnt[hi] == 0) hi += 1;
+	if (lo < 0) v = tc->bin[hi] / TC_CNT;			//only learned above: hold the nearest
+	else if (hi >= TC_BINS) v = tc->bin[lo] / TC_CNT;	//only learned below: hold the nearest
+	else {								//interpolate between the bin centers
+		v = tc->bin[lo] / TC_CNT;
+		v+= (int64_t) (tc->bin[hi] / TC_CNT - v) * (pos - lo * TC_W - TC_W / 2) / ((hi - lo) * TC_W);
+	}
+	*frac = (uint32_t) (v & 0xff) << 24;
+	return tc->f0 + (v >> 8);			//rounded down, frac is always positive
+}
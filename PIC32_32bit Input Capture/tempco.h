@@ -0,0 +1,38 @@
+#ifndef TEMPCO_H_INCLUDED
+#define TEMPCO_H_INCLUDED
+
+#include <stdint.h>						//we use int32_t
+
+//model configuration
+//temperature is in raw adc codes, 16x oversampled 10-bit: 0..16383
+//defaults: MCP9700 at 3.3v -> 2482 @ 0C, 49.6 codes/C, 32 bins of 2.6C from -11C to +73C
+#define TC_LO					1920				//code at the low end of the first bin
+#define TC_SHIFT				7					//bin width = 2^TC_SHIFT codes
+#define TC_BINS					32					//number of bins
+#define TC_CNT					16					//weight used in averaging a bin
+//end model configuration
+
+//global defines
+
+//frequency vs. temperature table, learned online
+//each bin holds the average frequency seen at its temperature, relative to f0, in 1/256Hz x TC_CNT
+typedef struct {
+	int32_t f0;							//reference frequency, Hz. 0 -> nothing learned yet
+	int32_t bin[TC_BINS];				//average frequency per bin
+	uint16_t cnt[TC_BINS];				//readings learned into each bin, saturating
+} tc_t;
+
+//global variables
+
+//reset the model
+void tc_init(tc_t *tc);
+
+//learn one frequency reading at temperature temp
+//freq: Hz, frac: fractional Hz, Q0.32
+void tc_learn(tc_t *tc, uint16_t temp, int32_t freq, uint32_t frac);
+
+//frequency predicted for temperature temp: linear interpolation between the nearest learned bins
+//return Hz, *frac = fractional Hz, Q0.32. return 0 if nothing has been learned yet
+int32_t tc_freq(tc_t *tc, uint16_t temp, uint32_t *frac);
+
+#endif /* TEMPCO_H_INCLUDED */
@@ -0,0 +1,102 @@
+//source file for the time of day, disciplined by the 1pps
+
+#include "todclk.h"						//we use time of day
+
+//hardware configuration
+//end hardware configuration
+
+//global defines
+//one edge, written by the capture isr only
+typedef struct {
+	uint32_t tick;						//timebase at the edge
+	int64_t sec;						//second starting at the edge
+	uint64_t inv;						//seconds per tick, Q8.56
+} tod_edge_t;
+
+//global variables
+static volatile tod_edge_t tod[2];		//double buffer: the isr fills one while the readers use the other
+static volatile uint8_t tod_cur;		//slot in use, flipped by the isr once the other is complete
+static volatile uint8_t tod_valid;		//1->an edge has been seen
+//requests from main, picked up by the isr at the next edge. the flag is cleared while the value is written
+static volatile uint64_t tod_inv_new; static volatile uint8_t tod_inv_req;
+static volatile int64_t tod_sec_new; static volatile uint8_t tod_sec_req;
+
+//seconds per tick, Q8.56, from ticks per second, Q32.32
+static uint64_t tod_inv(uint64_t tps) {
+	tps >>= 25;							//ticks per second, Q7: 2^63 / (tps x 2^7) = 2^56 / tps
+	return tps ? (1ull << 63) / tps : 0;
+}
+
+//reset the clock
+void todclk_init(uint32_t tps) {
+	tod_valid = tod_inv_req = tod_sec_req = 0;
+	tod_cur = 0;
+	tod[0].sec = 0;
+	tod[0].inv = tod_inv((uint64_t) tps << 32);
+}
+
+//a 1pps edge
+//the seconds advance by the whole seconds elapsed since the last edge: missed edges are bridged
+void todclk_edge(uint32_t tick) {
+	volatile tod_edge_t *o = &tod[tod_cur], *n = &tod[tod_cur ^ 1];
+
+	n->tick = tick;
+	n->inv = o->inv;
+	if (tod_valid == 0) n->sec = 0;
+	else if (o->inv == 0) n->sec = o->sec + 1;	//rate unknown yet: one edge per second
+	else n->sec = o->sec + (int64_t) (((uint64_t) (tick - o->tick) * o->inv + (1ull << 55)) >> 56);
+	if (tod_sec_req) {n->sec = tod_sec_new; tod_sec_req = 0;}
+	if (tod_inv_req) {n->inv = tod_inv_new; tod_inv_req = 0;}
+	tod_valid = 1;
+	tod_cur ^= 1;						//publish the edge, after it has been written
+}
+
+//measured timebase rate
+void todclk_rate(uint64_t tps) {
+	tod_inv_req = 0;
+	tod_inv_new = tod_inv(tps);
+	tod_inv_req = 1;
+}
+
+//number the seconds
+void todclk_set(int64_t sec) {
+	tod_sec_req = 0;
+	tod_sec_new = sec + 1;				//second starting at the next edge
+	tod_sec_req = 1;
+}
+
+//consistent copy of the slot in use: retried if an edge was published meanwhile
+static void tod_snap(tod_edge_t *s) {
+	uint8_t i;
+
+	do {
+		i = tod_cur;
+		s->tick = tod[i].tick; s->sec = tod[i].sec; s->inv = tod[i].inv;
+	} while (i != tod_cur);
+}
+
+//time of tick, from an edge
+static void tod_calc(const tod_edge_t *s, uint32_t tick, tod_t *t) {
+	int64_t d;
+
+	if (tod_valid == 0) {t->sec = 0; t->frac = 0; return;}
+	d = (int64_t) (int32_t) (tick - s->tick) * (int64_t) s->inv;	//seconds since the edge, Q8.56. negative for a tick before it
+	t->sec = s->sec + (d >> 56);
+	t->frac = (uint32_t) (d >> 24);
+}
+
+//time of a timebase reading
+void todclk_at(uint32_t tick, tod_t *t) {
+	tod_edge_t s;
+
+	tod_snap(&s);
+	tod_calc(&s, tick, t);
+}
+
+//time now
+void todclk_get(tod_t *t) {
+	tod_edge_t s;
+
+	tod_snap(&s);						//the edge first, then the timebase: an edge in between only makes it > 1s ago
+	tod_calc(&s, TODCLK_NOW(), t);
+}
@@ -0,0 +1,48 @@
+#ifndef TODCLK_H_INCLUDED
+#define TODCLK_H_INCLUDED
+
+#include "gpio.h"
+
+//time of day, disciplined by the 1pps
+//the time is counted in whole seconds at the 1pps edges, and interpolated between them on the
+//free-running capture timebase, at the rate the filter has measured for it: application code gets
+//the 1pps' time, not the nominal clock's. todclk_get() / todclk_at() are a 32x64-bit multiply and
+//don't mask interrupts: they can be called from any isr, at any priority.
+//valid within 128s and 2^31 timebase ticks of the last edge.
+
+//hardware configuration
+#define TODCLK_NOW()			(TMR2)				//timebase: the 32-bit TMR2/3 pair the captures are taken on
+//end hardware configuration
+
+//global defines
+
+//a time
+typedef struct {
+	int64_t sec;						//seconds
+	uint32_t frac;						//fraction of a second, Q0.32
+} tod_t;
+
+//global variables
+
+//reset the clock
+//tps: nominal timebase ticks per second, used until todclk_rate() is first called. 0 -> unknown
+void todclk_init(uint32_t tps);
+
+//a 1pps edge, captured at tick. call from the capture isr, on every edge
+void todclk_edge(uint32_t tick);
+
+//measured timebase rate, ticks per second in Q32.32, from the filter. call from main
+//takes effect at the next edge
+void todclk_rate(uint64_t tps);
+
+//number the seconds: the last edge was second sec, e.g. from a gps time message. call from main
+//takes effect at the next edge, as second sec + 1
+void todclk_set(int64_t sec);
+
+//time now
+void todclk_get(tod_t *t);
+
+//time of a timebase reading, e.g. a capture
+void todclk_at(uint32_t tick, tod_t *t);
+
+#endif /* TODCLK_H_INCLUDED */